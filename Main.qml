@@ -10,6 +10,9 @@ ApplicationWindow {
     visible: true
     title: qsTr("Hello World")
 
+    // Frame timing overlay, off unless main.cpp sees VELOXR_HUD=1
+    property bool showHud: false
+
 
     Window {
         visible: true
@@ -17,9 +20,25 @@ ApplicationWindow {
         height: 720
 
         VulkanRenderItem {
+            id: renderItem
             anchors.fill:parent
         }
 
+        Text {
+            visible: window.showHud
+            anchors.top: parent.top
+            anchors.left: parent.left
+            anchors.margins: 8
+            color: "white"
+            font.family: "monospace"
+            text: "GPU upload " + renderItem.gpuUploadMs.toFixed(2) + " render " + renderItem.gpuRenderMs.toFixed(2)
+                  + " p95 " + renderItem.gpuFrameP95Ms.toFixed(2) + " ms\n"
+                  + "CPU acquire " + renderItem.cpuAcquireMs.toFixed(2) + " record " + renderItem.cpuRecordMs.toFixed(2)
+                  + " submit " + renderItem.cpuSubmitMs.toFixed(2) + " present " + renderItem.cpuPresentMs.toFixed(2) + " ms\n"
+                  + "Frame p50 " + renderItem.cpuFrameP50Ms.toFixed(2) + " p95 " + renderItem.cpuFrameP95Ms.toFixed(2)
+                  + " p99 " + renderItem.cpuFrameP99Ms.toFixed(2) + " ms"
+        }
+
     }
 
 
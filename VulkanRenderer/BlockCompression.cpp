@@ -0,0 +1,487 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VELOXR_BC_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VELOXR_BC_NEON 1
+#endif
+
+using namespace Veloxr;
+
+namespace {
+    // BC7 4-bit index interpolation weights, out of 64.
+    constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    constexpr float BC7_LS_WEIGHTS[16] = {0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+                                          34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f};
+
+    // Per channel min and max over the 16 RGBA texels of a block.
+    void blockBounds(const unsigned char* block, unsigned char minColor[4], unsigned char maxColor[4]) {
+#if defined(VELOXR_BC_SSE2)
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 48));
+        __m128i lo = _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d));
+        __m128i hi = _mm_max_epu8(_mm_max_epu8(a, b), _mm_max_epu8(c, d));
+        lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 8));
+        hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 8));
+        lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+        hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+        int packedMin = _mm_cvtsi128_si32(lo);
+        int packedMax = _mm_cvtsi128_si32(hi);
+        std::memcpy(minColor, &packedMin, 4);
+        std::memcpy(maxColor, &packedMax, 4);
+#elif defined(VELOXR_BC_NEON)
+        uint8x16_t a = vld1q_u8(block);
+        uint8x16_t b = vld1q_u8(block + 16);
+        uint8x16_t c = vld1q_u8(block + 32);
+        uint8x16_t d = vld1q_u8(block + 48);
+        uint8x16_t lo = vminq_u8(vminq_u8(a, b), vminq_u8(c, d));
+        uint8x16_t hi = vmaxq_u8(vmaxq_u8(a, b), vmaxq_u8(c, d));
+        uint8x8_t lo8 = vmin_u8(vget_low_u8(lo), vget_high_u8(lo));
+        uint8x8_t hi8 = vmax_u8(vget_low_u8(hi), vget_high_u8(hi));
+        lo8 = vmin_u8(lo8, vext_u8(lo8, lo8, 4));
+        hi8 = vmax_u8(hi8, vext_u8(hi8, hi8, 4));
+        uint8_t loBytes[8], hiBytes[8];
+        vst1_u8(loBytes, lo8);
+        vst1_u8(hiBytes, hi8);
+        std::memcpy(minColor, loBytes, 4);
+        std::memcpy(maxColor, hiBytes, 4);
+#else
+        for (int c = 0; c < 4; c++) {
+            minColor[c] = 255;
+            maxColor[c] = 0;
+        }
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 4; c++) {
+                minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+                maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+            }
+        }
+#endif
+    }
+
+    // Bounding box endpoints, flipped per channel to follow the block's dominant direction against green
+    // and inset a little so the extremes land on interpolated palette entries instead of clipping.
+    void chooseEndpoints(const unsigned char* block, int channels, int insetShift, int e0[4], int e1[4]) {
+        unsigned char minColor[4], maxColor[4];
+        blockBounds(block, minColor, maxColor);
+
+        int mean[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 4; c++) mean[c] += block[i * 4 + c];
+        }
+        for (int c = 0; c < 4; c++) mean[c] = (mean[c] + 8) / 16;
+
+        int covariance[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 16; i++) {
+            int g = block[i * 4 + 1] - mean[1];
+            for (int c = 0; c < 4; c++) covariance[c] += (block[i * 4 + c] - mean[c]) * g;
+        }
+
+        for (int c = 0; c < 4; c++) {
+            int inset = (maxColor[c] - minColor[c]) >> insetShift;
+            int lo = minColor[c] + inset;
+            int hi = maxColor[c] - inset;
+            bool flip = c != 1 && c < channels && covariance[c] < 0;
+            e0[c] = flip ? lo : hi;
+            e1[c] = flip ? hi : lo;
+        }
+    }
+
+    uint16_t to565(const int color[4]) {
+        int r = (color[0] * 31 + 127) / 255;
+        int g = (color[1] * 63 + 127) / 255;
+        int b = (color[2] * 31 + 127) / 255;
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void from565(uint16_t packed, int color[4]) {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+        color[3] = 255;
+    }
+
+    uint32_t packRGBA(const int color[4]) {
+        return static_cast<uint32_t>(color[0]) | (static_cast<uint32_t>(color[1]) << 8) |
+            (static_cast<uint32_t>(color[2]) << 16) | (static_cast<uint32_t>(color[3]) << 24);
+    }
+
+    // Closest palette entry of every texel by squared distance over the channels left in channelMask,
+    // ties go to the lower entry. Returns the summed error.
+    int nearestIndices(const unsigned char* block, const uint32_t* palette, int paletteSize, uint32_t channelMask, int indices[16]) {
+#if defined(VELOXR_BC_SSE2)
+        // Two texels per register at 16 bits per channel, madd squares and sums channel pairs.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i mask = _mm_set1_epi32(static_cast<int>(channelMask));
+        __m128i texels[8];
+        for (int k = 0; k < 4; k++) {
+            __m128i four = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + k * 16)), mask);
+            texels[k * 2] = _mm_unpacklo_epi8(four, zero);
+            texels[k * 2 + 1] = _mm_unpackhi_epi8(four, zero);
+        }
+        __m128i bestError[4], bestIndex[4];
+        for (int k = 0; k < 4; k++) {
+            bestError[k] = _mm_set1_epi32(INT32_MAX);
+            bestIndex[k] = zero;
+        }
+        for (int p = 0; p < paletteSize; p++) {
+            __m128i entry = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(palette[p] & channelMask)), zero);
+            __m128i index = _mm_set1_epi32(p);
+            for (int k = 0; k < 4; k++) {
+                __m128i d0 = _mm_sub_epi16(texels[k * 2], entry);
+                __m128i d1 = _mm_sub_epi16(texels[k * 2 + 1], entry);
+                __m128i s0 = _mm_madd_epi16(d0, d0);
+                __m128i s1 = _mm_madd_epi16(d1, d1);
+                s0 = _mm_add_epi32(s0, _mm_shuffle_epi32(s0, _MM_SHUFFLE(2, 3, 0, 1)));
+                s1 = _mm_add_epi32(s1, _mm_shuffle_epi32(s1, _MM_SHUFFLE(2, 3, 0, 1)));
+                __m128i error = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(s0), _mm_castsi128_ps(s1), _MM_SHUFFLE(2, 0, 2, 0)));
+                __m128i better = _mm_cmplt_epi32(error, bestError[k]);
+                bestError[k] = _mm_or_si128(_mm_and_si128(better, error), _mm_andnot_si128(better, bestError[k]));
+                bestIndex[k] = _mm_or_si128(_mm_and_si128(better, index), _mm_andnot_si128(better, bestIndex[k]));
+            }
+        }
+        __m128i total = zero;
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + k * 4), bestIndex[k]);
+            total = _mm_add_epi32(total, bestError[k]);
+        }
+        total = _mm_add_epi32(total, _mm_srli_si128(total, 8));
+        total = _mm_add_epi32(total, _mm_srli_si128(total, 4));
+        return _mm_cvtsi128_si32(total);
+#elif defined(VELOXR_BC_NEON)
+        // Four texels per register, absolute differences squared to 16 bits and summed pairwise.
+        const uint8x16_t mask = vreinterpretq_u8_u32(vdupq_n_u32(channelMask));
+        uint8x16_t texels[4];
+        uint32x4_t bestError[4], bestIndex[4];
+        for (int k = 0; k < 4; k++) {
+            texels[k] = vandq_u8(vld1q_u8(block + k * 16), mask);
+            bestError[k] = vdupq_n_u32(UINT32_MAX);
+            bestIndex[k] = vdupq_n_u32(0);
+        }
+        for (int p = 0; p < paletteSize; p++) {
+            uint8x16_t entry = vreinterpretq_u8_u32(vdupq_n_u32(palette[p] & channelMask));
+            uint32x4_t index = vdupq_n_u32(static_cast<uint32_t>(p));
+            for (int k = 0; k < 4; k++) {
+                uint8x16_t d = vabdq_u8(texels[k], entry);
+                uint32x4_t lo = vpaddlq_u16(vmull_u8(vget_low_u8(d), vget_low_u8(d)));
+                uint32x4_t hi = vpaddlq_u16(vmull_u8(vget_high_u8(d), vget_high_u8(d)));
+                uint32x4_t error = vcombine_u32(vpadd_u32(vget_low_u32(lo), vget_high_u32(lo)), vpadd_u32(vget_low_u32(hi), vget_high_u32(hi)));
+                uint32x4_t better = vcltq_u32(error, bestError[k]);
+                bestError[k] = vbslq_u32(better, error, bestError[k]);
+                bestIndex[k] = vbslq_u32(better, index, bestIndex[k]);
+            }
+        }
+        uint32x4_t total = vdupq_n_u32(0);
+        for (int k = 0; k < 4; k++) {
+            uint32_t best[4];
+            vst1q_u32(best, bestIndex[k]);
+            for (int i = 0; i < 4; i++) indices[k * 4 + i] = static_cast<int>(best[i]);
+            total = vaddq_u32(total, bestError[k]);
+        }
+        uint32x2_t sum = vadd_u32(vget_low_u32(total), vget_high_u32(total));
+        return static_cast<int>(vget_lane_u32(vpadd_u32(sum, sum), 0));
+#else
+        int total = 0;
+        for (int i = 0; i < 16; i++) {
+            const unsigned char* texel = block + i * 4;
+            int best = 0;
+            int bestError = INT32_MAX;
+            for (int p = 0; p < paletteSize; p++) {
+                int error = 0;
+                for (int c = 0; c < 4; c++) {
+                    if (!((channelMask >> (c * 8)) & 0xFF)) continue;
+                    int d = texel[c] - static_cast<int>((palette[p] >> (c * 8)) & 0xFF);
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices[i] = best;
+            total += bestError;
+        }
+        return total;
+#endif
+    }
+
+    // One least squares pass: the endpoints that best reproduce the block with its indices held fixed.
+    // weights[p] is how far palette entry p lies from e0 towards e1. False when every texel picked the
+    // same weight, the system has no unique solution then.
+    bool refineEndpoints(const unsigned char* block, const int indices[16], const float* weights, int channels, int e0[4], int e1[4]) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float bx[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < 16; i++) {
+            float w = weights[indices[i]];
+            float v = 1.0f - w;
+            aa += v * v;
+            ab += v * w;
+            bb += w * w;
+            for (int c = 0; c < channels; c++) {
+                ax[c] += v * block[i * 4 + c];
+                bx[c] += w * block[i * 4 + c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (determinant < 1e-4f) return false;
+
+        for (int c = 0; c < channels; c++) {
+            float a = (ax[c] * bb - bx[c] * ab) / determinant;
+            float b = (bx[c] * aa - ax[c] * ab) / determinant;
+            e0[c] = std::clamp(static_cast<int>(a + 0.5f), 0, 255);
+            e1[c] = std::clamp(static_cast<int>(b + 0.5f), 0, 255);
+        }
+        return true;
+    }
+
+    // Where BC1 palette entries 0 to 3 sit between the two endpoints.
+    constexpr float BC1_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+    // Quantizes the endpoints to 565 and picks indices, returns the block's error.
+    int fitBC1(const unsigned char* block, const int e0[4], const int e1[4], uint16_t& c0, uint16_t& c1, int indices[16]) {
+        c0 = to565(e0);
+        c1 = to565(e1);
+        int palette[4][4];
+        from565(c0, palette[0]);
+        from565(c1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+        }
+        palette[2][3] = palette[3][3] = 255;
+        uint32_t packed[4];
+        for (int p = 0; p < 4; p++) packed[p] = packRGBA(palette[p]);
+        // Equal endpoints select the three colour mode, where only entry 0 means the same thing.
+        return nearestIndices(block, packed, c0 == c1 ? 1 : 4, 0x00FFFFFFu, indices);
+    }
+
+    // Mode 6: 7 bits per channel plus one shared p-bit per endpoint, pick the p-bit that quantizes best.
+    // Then picks indices, returns the block's error.
+    int fitBC7(const unsigned char* block, const int e0[4], const int e1[4], int quantized[2][4], int pbits[2], int indices[16]) {
+        int endpoints[2][4];
+        const int* sources[2] = {e0, e1};
+        for (int e = 0; e < 2; e++) {
+            int bestError = INT32_MAX;
+            for (int p = 0; p < 2; p++) {
+                int error = 0;
+                int q[4];
+                for (int c = 0; c < 4; c++) {
+                    q[c] = std::clamp((sources[e][c] - p + 1) >> 1, 0, 127);
+                    int reconstructed = (q[c] << 1) | p;
+                    error += (reconstructed - sources[e][c]) * (reconstructed - sources[e][c]);
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    pbits[e] = p;
+                    std::copy(q, q + 4, quantized[e]);
+                }
+            }
+            for (int c = 0; c < 4; c++) endpoints[e][c] = (quantized[e][c] << 1) | pbits[e];
+        }
+
+        uint32_t palette[16];
+        for (int i = 0; i < 16; i++) {
+            int color[4];
+            for (int c = 0; c < 4; c++) {
+                color[c] = ((64 - BC7_WEIGHTS[i]) * endpoints[0][c] + BC7_WEIGHTS[i] * endpoints[1][c] + 32) >> 6;
+            }
+            palette[i] = packRGBA(color);
+        }
+        return nearestIndices(block, palette, 16, 0xFFFFFFFFu, indices);
+    }
+
+    // Little endian bit packer for the 128-bit BC7 block.
+    struct BitWriter {
+        unsigned char* out;
+        uint32_t position = 0;
+
+        void put(uint32_t value, uint32_t bits) {
+            for (uint32_t i = 0; i < bits; i++, position++) {
+                if (value & (1u << i)) out[position >> 3] |= static_cast<unsigned char>(1u << (position & 7));
+            }
+        }
+    };
+}
+
+uint32_t BlockCompression::blockBytes(TileFormat format) {
+    switch (format) {
+        case TileFormat::BC1: return 8;
+        case TileFormat::BC7: return 16;
+        default: return 4;
+    }
+}
+
+uint64_t BlockCompression::levelSize(TileFormat format, uint32_t width, uint32_t height) {
+    if (format == TileFormat::RGBA8) return static_cast<uint64_t>(width) * height * 4;
+    uint64_t blocksX = (width + 3) / 4;
+    uint64_t blocksY = (height + 3) / 4;
+    return blocksX * blocksY * blockBytes(format);
+}
+
+uint32_t BlockCompression::fullMipChain(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while ((width | height) > 1) {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+uint64_t BlockCompression::levelOffset(TileFormat format, uint32_t width, uint32_t height, uint32_t level) {
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < level; i++) {
+        offset += levelSize(format, std::max(1u, width >> i), std::max(1u, height >> i));
+    }
+    return offset;
+}
+
+uint64_t BlockCompression::chainSize(TileFormat format, uint32_t width, uint32_t height) {
+    return levelOffset(format, width, height, fullMipChain(width, height));
+}
+
+void BlockCompression::encodeBC1Block(const unsigned char* block, unsigned char* out) {
+    int e0[4], e1[4];
+    chooseEndpoints(block, 3, 4, e0, e1);
+
+    uint16_t c0, c1;
+    int best[16];
+    int error = fitBC1(block, e0, e1, c0, c1, best);
+    // The bounding box guess only decides the indices, least squares then fits the endpoints to them.
+    if (error > 0 && refineEndpoints(block, best, BC1_WEIGHTS, 3, e0, e1)) {
+        uint16_t r0, r1;
+        int refined[16];
+        if (fitBC1(block, e0, e1, r0, r1, refined) < error) {
+            c0 = r0;
+            c1 = r1;
+            std::copy(refined, refined + 16, best);
+        }
+    }
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        for (int i = 0; i < 16; i++) indices |= static_cast<uint32_t>(best[i]) << (i * 2);
+        // Four colour mode needs c0 > c1, swapping the endpoints swaps indices 0/1 and 2/3.
+        if (c0 < c1) {
+            std::swap(c0, c1);
+            indices ^= 0x55555555u;
+        }
+    }
+
+    out[0] = static_cast<unsigned char>(c0 & 0xFF);
+    out[1] = static_cast<unsigned char>(c0 >> 8);
+    out[2] = static_cast<unsigned char>(c1 & 0xFF);
+    out[3] = static_cast<unsigned char>(c1 >> 8);
+    std::memcpy(out + 4, &indices, 4);
+}
+
+void BlockCompression::encodeBC7Block(const unsigned char* block, unsigned char* out) {
+    int e0[4], e1[4];
+    chooseEndpoints(block, 4, 5, e0, e1);
+
+    int quantized[2][4];
+    int pbits[2];
+    int indices[16];
+    int error = fitBC7(block, e0, e1, quantized, pbits, indices);
+    if (error > 0 && refineEndpoints(block, indices, BC7_LS_WEIGHTS, 4, e0, e1)) {
+        int refinedQuantized[2][4];
+        int refinedPbits[2];
+        int refined[16];
+        if (fitBC7(block, e0, e1, refinedQuantized, refinedPbits, refined) < error) {
+            std::copy(&refinedQuantized[0][0], &refinedQuantized[0][0] + 8, &quantized[0][0]);
+            std::copy(refinedPbits, refinedPbits + 2, pbits);
+            std::copy(refined, refined + 16, indices);
+        }
+    }
+
+    // The first index is stored without its top bit, swap the endpoints when it would be set.
+    if (indices[0] & 8) {
+        for (int c = 0; c < 4; c++) std::swap(quantized[0][c], quantized[1][c]);
+        std::swap(pbits[0], pbits[1]);
+        for (int i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+    }
+
+    std::memset(out, 0, 16);
+    BitWriter writer{out};
+    writer.put(1u << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.put(quantized[0][c], 7);
+        writer.put(quantized[1][c], 7);
+    }
+    writer.put(pbits[0], 1);
+    writer.put(pbits[1], 1);
+    writer.put(indices[0], 3);
+    for (int i = 1; i < 16; i++) writer.put(indices[i], 4);
+}
+
+TextureData BlockCompression::compressTile(const TextureData& rgba, TileFormat format) {
+    TextureData result{};
+    result.width = rgba.width;
+    result.height = rgba.height;
+    result.channels = 4;
+    result.format = format;
+    if (format == TileFormat::RGBA8 || rgba.width == 0 || rgba.height == 0) return rgba;
+
+    result.mipLevels = fullMipChain(rgba.width, rgba.height);
+    result.pixelData.resize(chainSize(format, rgba.width, rgba.height));
+    uint32_t bytesPerBlock = blockBytes(format);
+
+    std::vector<unsigned char> level = rgba.pixelData;
+    std::vector<unsigned char> next;
+    uint32_t width = rgba.width;
+    uint32_t height = rgba.height;
+    unsigned char* out = result.pixelData.data();
+    unsigned char block[64];
+
+    for (uint32_t mip = 0; mip < result.mipLevels; mip++) {
+        // Blocks hanging over the edge repeat the last row and column.
+        for (uint32_t by = 0; by < height; by += 4) {
+            for (uint32_t bx = 0; bx < width; bx += 4) {
+                for (uint32_t y = 0; y < 4; y++) {
+                    uint32_t sy = std::min(by + y, height - 1);
+                    for (uint32_t x = 0; x < 4; x++) {
+                        uint32_t sx = std::min(bx + x, width - 1);
+                        std::memcpy(block + (y * 4 + x) * 4, level.data() + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                    }
+                }
+                if (format == TileFormat::BC1) encodeBC1Block(block, out);
+                else encodeBC7Block(block, out);
+                out += bytesPerBlock;
+            }
+        }
+
+        if (mip + 1 == result.mipLevels) break;
+
+        // 2x2 box filter, odd edges average what they have like the tile cache pyramid.
+        uint32_t nextWidth = std::max(1u, width / 2);
+        uint32_t nextHeight = std::max(1u, height / 2);
+        next.assign(static_cast<size_t>(nextWidth) * nextHeight * 4, 0);
+        for (uint32_t y = 0; y < nextHeight; y++) {
+            uint32_t y0 = std::min(y * 2, height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < nextWidth; x++) {
+                uint32_t x0 = std::min(x * 2, width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                for (uint32_t c = 0; c < 4; c++) {
+                    uint32_t sum = level[(static_cast<size_t>(y0) * width + x0) * 4 + c] + level[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                                   level[(static_cast<size_t>(y1) * width + x0) * 4 + c] + level[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                    next[(static_cast<size_t>(y) * nextWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        level.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return result;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <TextureTiling.h>
+#include <VulkanRenderer_global.h>
+
+namespace Veloxr {
+
+    // CPU encoders for GPU block compressed tiles. Both work on 4x4 texel blocks:
+    //   BC1  8 bytes per block, opaque RGB, 4 bits per texel
+    //   BC7 16 bytes per block (mode 6 only), RGBA, 8 bits per texel
+    // Endpoints start from the block's bounding box and get one least squares pass over the indices they chose.
+    // Runs inside the tile loader workers, so tiles are encoded in parallel with each other.
+    class VULKANRENDERER_EXPORT BlockCompression {
+
+        public:
+            static uint32_t blockBytes(TileFormat format);
+            static uint64_t levelSize(TileFormat format, uint32_t width, uint32_t height);
+            static uint32_t fullMipChain(uint32_t width, uint32_t height);
+            // Bytes of levels [0, level), i.e. where that level starts inside a packed chain.
+            static uint64_t levelOffset(TileFormat format, uint32_t width, uint32_t height, uint32_t level);
+            static uint64_t chainSize(TileFormat format, uint32_t width, uint32_t height);
+
+            // Box filters an RGBA8 tile down to 1x1 and encodes every level back to back.
+            static TextureData compressTile(const TextureData& rgba, TileFormat format);
+
+            static void encodeBC1Block(const unsigned char* block, unsigned char* out);
+            static void encodeBC7Block(const unsigned char* block, unsigned char* out);
+    };
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace Veloxr {
+
+    // Fixed capacity lock-free multi-producer multi-consumer FIFO.
+    // Every cell carries a sequence number: producers claim a cell when its sequence equals their
+    // ticket, consumers when it equals ticket + 1, so neither side ever takes a lock.
+    // Capacity is rounded up to a power of two. Both calls fail instead of waiting.
+    template <typename T>
+    class BoundedQueue {
+
+        public:
+            explicit BoundedQueue(size_t capacity) {
+                size_t size = 2;
+                while (size < capacity) size <<= 1;
+                _mask = size - 1;
+                _cells = std::make_unique<Cell[]>(size);
+                for (size_t i = 0; i < size; i++) _cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            BoundedQueue(const BoundedQueue&) = delete;
+            BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+            // False when the queue is full, value is left untouched.
+            bool tryPush(T&& value) {
+                Cell* cell;
+                size_t position = _tail.load(std::memory_order_relaxed);
+                while (true) {
+                    cell = &_cells[position & _mask];
+                    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                    intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                    if (diff == 0) {
+                        if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                    } else if (diff < 0) {
+                        return false;
+                    } else {
+                        position = _tail.load(std::memory_order_relaxed);
+                    }
+                }
+                cell->value = std::move(value);
+                cell->sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+
+            // False when the queue is empty.
+            bool tryPop(T& value) {
+                Cell* cell;
+                size_t position = _head.load(std::memory_order_relaxed);
+                while (true) {
+                    cell = &_cells[position & _mask];
+                    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                    intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+                    if (diff == 0) {
+                        if (_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                    } else if (diff < 0) {
+                        return false;
+                    } else {
+                        position = _head.load(std::memory_order_relaxed);
+                    }
+                }
+                value = std::move(cell->value);
+                cell->value = T{}; // Large payloads are freed here, not when the cell is reused
+                cell->sequence.store(position + _mask + 1, std::memory_order_release);
+                return true;
+            }
+
+            inline size_t getCapacity() const { return _mask + 1; }
+
+        private:
+            struct Cell {
+                std::atomic<size_t> sequence;
+                T value;
+            };
+
+            // Producers and consumers hammer different counters, keep them off each other's cache line.
+            static constexpr size_t CACHE_LINE = 64;
+
+            std::unique_ptr<Cell[]> _cells;
+            size_t _mask{0};
+            alignas(CACHE_LINE) std::atomic<size_t> _tail{0};
+            alignas(CACHE_LINE) std::atomic<size_t> _head{0};
+    };
+
+}
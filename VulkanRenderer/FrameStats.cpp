@@ -0,0 +1,173 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Veloxr;
+
+FrameTimeHistogram::FrameTimeHistogram() : _window(WINDOW, 0) {
+}
+
+uint32_t FrameTimeHistogram::_bucketOf(double ms) {
+    if (!(ms > MIN_MS)) return 0;
+    // ms / MIN_MS = mantissa * 2^exponent with mantissa in [0.5, 1)
+    int exponent;
+    double mantissa = std::frexp(ms / MIN_MS, &exponent);
+    uint32_t octave = static_cast<uint32_t>(exponent - 1);
+    if (octave >= OCTAVES) return SUB_BUCKETS * OCTAVES - 1;
+    uint32_t sub = std::min(static_cast<uint32_t>((mantissa * 2.0 - 1.0) * SUB_BUCKETS), SUB_BUCKETS - 1);
+    return octave * SUB_BUCKETS + sub;
+}
+
+double FrameTimeHistogram::_bucketMidpoint(uint32_t bucket) {
+    uint32_t octave = bucket / SUB_BUCKETS;
+    double sub = bucket % SUB_BUCKETS + 0.5;
+    return MIN_MS * std::ldexp(1.0 + sub / SUB_BUCKETS, static_cast<int>(octave));
+}
+
+void FrameTimeHistogram::add(double ms) {
+    if (_count == WINDOW) {
+        _buckets[_window[_next]]--;
+    } else {
+        _count++;
+    }
+    uint32_t bucket = _bucketOf(ms);
+    _window[_next] = static_cast<uint8_t>(bucket);
+    _buckets[bucket]++;
+    _next = (_next + 1) % WINDOW;
+}
+
+double FrameTimeHistogram::percentile(double p) const {
+    if (_count == 0) return 0.0;
+    uint32_t rank = static_cast<uint32_t>(std::ceil(std::clamp(p, 0.0, 1.0) * _count));
+    rank = std::max<uint32_t>(rank, 1);
+    uint32_t seen = 0;
+    for (uint32_t bucket = 0; bucket < _buckets.size(); bucket++) {
+        seen += _buckets[bucket];
+        if (seen >= rank) return _bucketMidpoint(bucket);
+    }
+    return _bucketMidpoint(static_cast<uint32_t>(_buckets.size()) - 1);
+}
+
+void GpuFrameTimer::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t transferQueueFamily, uint32_t frames) {
+    _device = device;
+    _recorded.assign(frames, false);
+    _resettingTransferSlots.assign(frames, {});
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+    uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+    if (validBits == 0) {
+        std::cerr << "Queue family " << queueFamily << " has no timestamp support, GPU frame times disabled.\n";
+        return;
+    }
+    _validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    _msPerTick = properties.limits.timestampPeriod / 1.0e6;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = frames * QUERIES_PER_FRAME;
+    if (vkCreateQueryPool(_device, &poolInfo, nullptr, &_pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    uint32_t transferValidBits = transferQueueFamily < familyCount ? families[transferQueueFamily].timestampValidBits : 0;
+    if (transferValidBits == 0) {
+        std::cerr << "Queue family " << transferQueueFamily << " has no timestamp support, transfer upload times disabled.\n";
+        return;
+    }
+    _transferValidMask = transferValidBits >= 64 ? ~0ull : (1ull << transferValidBits) - 1;
+
+    poolInfo.queryCount = TRANSFER_SLOTS * 2;
+    if (vkCreateQueryPool(_device, &poolInfo, nullptr, &_transferPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create transfer timestamp query pool!");
+    }
+    // Fresh queries are unavailable but still need a reset before their first write
+    for (uint32_t slot = 0; slot < TRANSFER_SLOTS; slot++) {
+        _finishedTransferSlots.push_back(slot);
+    }
+}
+
+void GpuFrameTimer::destroy() {
+    if (_pool != VK_NULL_HANDLE) vkDestroyQueryPool(_device, _pool, nullptr);
+    if (_transferPool != VK_NULL_HANDLE) vkDestroyQueryPool(_device, _transferPool, nullptr);
+    _pool = VK_NULL_HANDLE;
+    _transferPool = VK_NULL_HANDLE;
+    _recorded.clear();
+    _freeTransferSlots.clear();
+    _finishedTransferSlots.clear();
+    _resettingTransferSlots.clear();
+    _transferMs = 0;
+}
+
+void GpuFrameTimer::recordBegin(VkCommandBuffer commandBuffer, uint32_t frame) {
+    if (!isSupported()) return;
+    vkCmdResetQueryPool(commandBuffer, _pool, frame * QUERIES_PER_FRAME, QUERIES_PER_FRAME);
+    for (uint32_t slot : _finishedTransferSlots) {
+        vkCmdResetQueryPool(commandBuffer, _transferPool, slot * 2, 2);
+    }
+    auto& resetting = _resettingTransferSlots[frame];
+    resetting.insert(resetting.end(), _finishedTransferSlots.begin(), _finishedTransferSlots.end());
+    _finishedTransferSlots.clear();
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _pool, frame * QUERIES_PER_FRAME);
+}
+
+void GpuFrameTimer::recordUploadsDone(VkCommandBuffer commandBuffer, uint32_t frame) {
+    if (!isSupported()) return;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _pool, frame * QUERIES_PER_FRAME + 1);
+}
+
+void GpuFrameTimer::recordEnd(VkCommandBuffer commandBuffer, uint32_t frame) {
+    if (!isSupported()) return;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _pool, frame * QUERIES_PER_FRAME + 2);
+    _recorded[frame] = true;
+}
+
+bool GpuFrameTimer::read(uint32_t frame, double& uploadMs, double& renderMs) {
+    if (!isSupported()) return false;
+    // The frame's fence has signaled, so the resets it carried are done
+    auto& resetting = _resettingTransferSlots[frame];
+    _freeTransferSlots.insert(_freeTransferSlots.end(), resetting.begin(), resetting.end());
+    resetting.clear();
+
+    if (!_recorded[frame]) return false;
+    uint64_t ticks[QUERIES_PER_FRAME];
+    if (vkGetQueryPoolResults(_device, _pool, frame * QUERIES_PER_FRAME, QUERIES_PER_FRAME, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return false;
+    }
+    // Masked differences survive the counter wrapping between two samples.
+    uploadMs = _transferMs + ((ticks[1] - ticks[0]) & _validMask) * _msPerTick;
+    renderMs = ((ticks[2] - ticks[1]) & _validMask) * _msPerTick;
+    _transferMs = 0;
+    return true;
+}
+
+uint32_t GpuFrameTimer::recordTransferBegin(VkCommandBuffer commandBuffer) {
+    if (_freeTransferSlots.empty()) return NO_TRANSFER_SLOT;
+    uint32_t slot = _freeTransferSlots.back();
+    _freeTransferSlots.pop_back();
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _transferPool, slot * 2);
+    return slot;
+}
+
+void GpuFrameTimer::recordTransferEnd(VkCommandBuffer commandBuffer, uint32_t slot) {
+    if (slot == NO_TRANSFER_SLOT) return;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _transferPool, slot * 2 + 1);
+}
+
+void GpuFrameTimer::finishTransfer(uint32_t slot) {
+    if (slot == NO_TRANSFER_SLOT || _transferPool == VK_NULL_HANDLE) return;
+    uint64_t ticks[2];
+    // Not ready when the batch was dropped before submitting, it only needs the reset then
+    if (vkGetQueryPoolResults(_device, _transferPool, slot * 2, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+        _transferMs += ((ticks[1] - ticks[0]) & _transferValidMask) * _msPerTick;
+    }
+    _finishedTransferSlots.push_back(slot);
+}
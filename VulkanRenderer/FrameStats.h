@@ -0,0 +1,106 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include <VulkanRenderer_global.h>
+
+namespace Veloxr {
+
+    // Milliseconds throughout. GPU times belong to the frame MAX_FRAMES_IN_FLIGHT back and stay 0
+    // when the graphics queue cannot write timestamps.
+    struct FrameStats {
+        uint64_t frames{0};
+        double gpuUploadMs{0};   // Transfer queue copies retired since the last frame, then upload acquires and mip generation
+        double gpuRenderMs{0};   // The render pass
+        double cpuWaitMs{0};     // Blocked on the frame in flight fence
+        double cpuUpdateMs{0};   // Tile residency: draining decodes, upload submits, new loads
+        double cpuAcquireMs{0};
+        double cpuRecordMs{0};
+        double cpuSubmitMs{0};
+        double cpuPresentMs{0};
+        double cpuFrameMs{0};    // All of drawFrame()
+        // Over the last FrameTimeHistogram::WINDOW frames
+        double cpuFrameP50Ms{0}, cpuFrameP95Ms{0}, cpuFrameP99Ms{0};
+        double gpuFrameP50Ms{0}, gpuFrameP95Ms{0}, gpuFrameP99Ms{0};
+    };
+
+    // Sliding window histogram with 16 log-spaced buckets per octave (about 4% resolution) from
+    // 1/64 ms to one second. Adding a sample evicts the oldest, both O(1).
+    class VULKANRENDERER_EXPORT FrameTimeHistogram {
+
+        public:
+            static constexpr uint32_t WINDOW = 1024;
+
+            FrameTimeHistogram();
+            void add(double ms);
+            // p in [0, 1], the middle of the bucket the percentile falls in. 0 while empty.
+            double percentile(double p) const;
+            inline uint32_t getSampleCount() const { return _count; }
+
+        private:
+            static constexpr uint32_t SUB_BUCKETS = 16;
+            static constexpr uint32_t OCTAVES = 16;
+            static constexpr double MIN_MS = 1.0 / 64.0;
+
+            static uint32_t _bucketOf(double ms);
+            static double _bucketMidpoint(uint32_t bucket);
+
+            std::array<uint32_t, SUB_BUCKETS * OCTAVES> _buckets{};
+            std::vector<uint8_t> _window; // Bucket of every sample, oldest at _next once full
+            uint32_t _next{0};
+            uint32_t _count{0};
+    };
+
+    // Timestamp queries around the upload and render work of each frame in flight. Results are read
+    // after the frame's fence so they never stall. Does nothing on queues without timestamp support.
+    // Transfer queue upload batches run outside the frames and get their own pool of query pairs.
+    class VULKANRENDERER_EXPORT GpuFrameTimer {
+
+        public:
+            GpuFrameTimer() = default;
+            void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t transferQueueFamily, uint32_t frames);
+            void destroy();
+
+            // Outside a render pass. Begin goes first in the frame, uploads done after the acquires
+            // and mip blits, end after the render pass.
+            void recordBegin(VkCommandBuffer commandBuffer, uint32_t frame);
+            void recordUploadsDone(VkCommandBuffer commandBuffer, uint32_t frame);
+            void recordEnd(VkCommandBuffer commandBuffer, uint32_t frame);
+
+            // False until the frame has been recorded once, or without timestamp support. The upload time
+            // includes every transfer batch finished since the previous read.
+            bool read(uint32_t frame, double& uploadMs, double& renderMs);
+
+            // Around the copies of one transfer batch. Begin returns the batch's slot, NO_TRANSFER_SLOT
+            // without support or while every slot is busy; both calls accept that.
+            uint32_t recordTransferBegin(VkCommandBuffer commandBuffer);
+            void recordTransferEnd(VkCommandBuffer commandBuffer, uint32_t slot);
+            // Once the batch's fence has signaled, or it was never submitted.
+            void finishTransfer(uint32_t slot);
+
+            inline bool isSupported() const { return _pool != VK_NULL_HANDLE; }
+
+            static constexpr uint32_t NO_TRANSFER_SLOT = UINT32_MAX;
+
+        private:
+            static constexpr uint32_t QUERIES_PER_FRAME = 3;
+            static constexpr uint32_t TRANSFER_SLOTS = 64;
+
+            VkDevice _device{VK_NULL_HANDLE};
+            VkQueryPool _pool{VK_NULL_HANDLE};
+            double _msPerTick{0};
+            uint64_t _validMask{0};
+            std::vector<bool> _recorded;
+
+            // Transfer-only families cannot reset queries, so finished slots are reset by the next
+            // recordBegin() and handed out again once that frame has been read.
+            VkQueryPool _transferPool{VK_NULL_HANDLE};
+            uint64_t _transferValidMask{0};
+            std::vector<uint32_t> _freeTransferSlots;
+            std::vector<uint32_t> _finishedTransferSlots;
+            std::vector<std::vector<uint32_t>> _resettingTransferSlots; // Per frame
+            double _transferMs{0};
+    };
+
+}
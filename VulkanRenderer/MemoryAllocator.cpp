@@ -0,0 +1,211 @@
+#include "MemoryAllocator.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Veloxr;
+
+void MemoryAllocator::init(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize) {
+    _device = device;
+    _blockSize = blockSize;
+    _blocks.clear();
+    _deviceAllocations = 0;
+    _allocatedBytes = 0;
+    _usedBytes = 0;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+}
+
+void MemoryAllocator::destroy() {
+    if (_device == VK_NULL_HANDLE) return;
+    if (_usedBytes > 0) {
+        std::cerr << "[MEMORY] " << (_usedBytes / 1024.0 / 1024.0) << " MB still allocated at shutdown.\n";
+    }
+    for (Block& block : _blocks) {
+        if (block.memory != VK_NULL_HANDLE) _releaseMemory(block.memory, block.size, block.mapped != nullptr);
+    }
+    _blocks.clear();
+    _device = VK_NULL_HANDLE;
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Kind kind) {
+    uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    VkDeviceSize blockSize = _blockSizeFor(memoryType);
+
+    MemoryAllocation allocation{};
+    // Huge tiles would fragment a block for little gain, give them their own memory.
+    if (requirements.size > blockSize / 2) {
+        allocation.memory = _allocateMemory(memoryType, requirements.size, &allocation.mapped);
+        allocation.size = requirements.size;
+        _usedBytes += allocation.size;
+        return allocation;
+    }
+
+    for (uint32_t i = 0; i < _blocks.size(); i++) {
+        const Block& block = _blocks[i];
+        if (block.memory == VK_NULL_HANDLE || block.memoryType != memoryType || block.kind != kind) continue;
+        if (block.size - block.used < requirements.size) continue;
+        if (_allocateFromBlock(i, requirements, allocation)) return allocation;
+    }
+
+    uint32_t blockIndex = _createBlock(memoryType, kind, blockSize);
+    if (!_allocateFromBlock(blockIndex, requirements, allocation)) {
+        throw std::runtime_error("failed to suballocate device memory!");
+    }
+    return allocation;
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation) {
+    if (!allocation.isValid()) return;
+    _usedBytes -= allocation.size;
+
+    if (allocation.isDedicated()) {
+        _releaseMemory(allocation.memory, allocation.size, allocation.mapped != nullptr);
+        allocation = {};
+        return;
+    }
+
+    Block& block = _blocks[allocation.block];
+    block.used -= allocation.size;
+
+    auto& ranges = block.freeRanges;
+    auto next = std::lower_bound(ranges.begin(), ranges.end(), allocation.offset,
+        [](const FreeRange& range, VkDeviceSize offset) { return range.offset < offset; });
+    auto it = ranges.insert(next, {allocation.offset, allocation.size});
+    if (std::next(it) != ranges.end() && it->offset + it->size == std::next(it)->offset) {
+        it->size += std::next(it)->size;
+        ranges.erase(std::next(it));
+    }
+    if (it != ranges.begin() && std::prev(it)->offset + std::prev(it)->size == it->offset) {
+        std::prev(it)->size += it->size;
+        ranges.erase(it);
+    }
+
+    // Keep one empty block per memory type and kind around so streaming does not thrash vkAllocateMemory,
+    // this one only goes if another is already empty. Partly used blocks do not count, they may never empty.
+    if (block.used == 0) {
+        for (uint32_t i = 0; i < _blocks.size(); i++) {
+            const Block& other = _blocks[i];
+            if (i == allocation.block || other.memory == VK_NULL_HANDLE) continue;
+            if (other.used == 0 && other.memoryType == block.memoryType && other.kind == block.kind) {
+                _releaseMemory(block.memory, block.size, block.mapped != nullptr);
+                block = Block{};
+                break;
+            }
+        }
+    }
+    allocation = {};
+}
+
+MemoryAllocation MemoryAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties) {
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(_device, image, &memRequirements);
+    MemoryAllocation allocation = allocate(memRequirements, properties, Kind::Optimal);
+    vkBindImageMemory(_device, image, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+MemoryAllocation MemoryAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties) {
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
+    MemoryAllocation allocation = allocate(memRequirements, properties, Kind::Linear);
+    vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+VkDeviceSize MemoryAllocator::_blockSizeFor(uint32_t memoryType) const {
+    // Small heaps (integrated GPUs, the BAR window) get proportionally smaller blocks.
+    VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    return std::max<VkDeviceSize>(std::min(_blockSize, heapSize / 8), 1024 * 1024);
+}
+
+bool MemoryAllocator::_allocateFromBlock(uint32_t blockIndex, const VkMemoryRequirements& requirements, MemoryAllocation& allocation) {
+    Block& block = _blocks[blockIndex];
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    for (size_t i = 0; i < block.freeRanges.size(); i++) {
+        FreeRange range = block.freeRanges[i];
+        VkDeviceSize start = (range.offset + alignment - 1) / alignment * alignment;
+        VkDeviceSize end = start + requirements.size;
+        if (end > range.offset + range.size) continue;
+
+        // Alignment padding in front stays free, only the tail is trimmed off.
+        block.freeRanges.erase(block.freeRanges.begin() + i);
+        if (end < range.offset + range.size) {
+            block.freeRanges.insert(block.freeRanges.begin() + i, {end, range.offset + range.size - end});
+        }
+        if (start > range.offset) {
+            block.freeRanges.insert(block.freeRanges.begin() + i, {range.offset, start - range.offset});
+        }
+
+        block.used += requirements.size;
+        _usedBytes += requirements.size;
+        allocation.memory = block.memory;
+        allocation.offset = start;
+        allocation.size = requirements.size;
+        allocation.mapped = block.mapped ? block.mapped + start : nullptr;
+        allocation.block = blockIndex;
+        return true;
+    }
+    return false;
+}
+
+uint32_t MemoryAllocator::_createBlock(uint32_t memoryType, Kind kind, VkDeviceSize size) {
+    Block block{};
+    block.memory = _allocateMemory(memoryType, size, &block.mapped);
+    block.size = size;
+    block.memoryType = memoryType;
+    block.kind = kind;
+    block.freeRanges.push_back({0, size});
+
+    std::cout << "[MEMORY] New " << (kind == Kind::Linear ? "buffer" : "image") << " block of "
+        << (size / 1024.0 / 1024.0) << " MB in memory type " << memoryType << "\n";
+
+    for (uint32_t i = 0; i < _blocks.size(); i++) {
+        if (_blocks[i].memory == VK_NULL_HANDLE) {
+            _blocks[i] = std::move(block);
+            return i;
+        }
+    }
+    _blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(_blocks.size() - 1);
+}
+
+VkDeviceMemory MemoryAllocator::_allocateMemory(uint32_t memoryType, VkDeviceSize size, unsigned char** mapped) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory!");
+    }
+    _deviceAllocations++;
+    _allocatedBytes += size;
+
+    // Host visible memory stays mapped for its whole life, suballocations cannot map it twice.
+    *mapped = nullptr;
+    if (_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void* data;
+        vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, &data);
+        *mapped = static_cast<unsigned char*>(data);
+    }
+    return memory;
+}
+
+void MemoryAllocator::_releaseMemory(VkDeviceMemory memory, VkDeviceSize size, bool mapped) {
+    if (mapped) vkUnmapMemory(_device, memory);
+    vkFreeMemory(_device, memory, nullptr);
+    _deviceAllocations--;
+    _allocatedBytes -= size;
+}
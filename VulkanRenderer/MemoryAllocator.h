@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include <VulkanRenderer_global.h>
+
+namespace Veloxr {
+
+    struct MemoryAllocation {
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkDeviceSize offset{0};
+        VkDeviceSize size{0};
+        unsigned char* mapped{nullptr}; // Host visible memory only, already advanced by offset
+        uint32_t block{UINT32_MAX};     // UINT32_MAX for dedicated allocations
+
+        inline bool isValid() const { return memory != VK_NULL_HANDLE; }
+        inline bool isDedicated() const { return block == UINT32_MAX; }
+    };
+
+    // Carves images and buffers out of a few large vkAllocateMemory blocks so thousands of tiles
+    // stay far below maxMemoryAllocationCount. Buffers and optimal images never share a block,
+    // which keeps bufferImageGranularity out of the picture entirely.
+    class VULKANRENDERER_EXPORT MemoryAllocator {
+
+        public:
+            enum class Kind { Linear, Optimal };
+
+            MemoryAllocator() = default;
+            void init(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize = 256ull * 1024 * 1024);
+            void destroy();
+
+            uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+            MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Kind kind);
+            void free(MemoryAllocation& allocation);
+
+            // Convenience wrappers that allocate and bind in one go.
+            MemoryAllocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties);
+            MemoryAllocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+
+            inline uint32_t getDeviceAllocationCount() const { return _deviceAllocations; }
+            inline VkDeviceSize getAllocatedBytes() const { return _allocatedBytes; }
+            inline VkDeviceSize getUsedBytes() const { return _usedBytes; }
+
+        private:
+            struct FreeRange {
+                VkDeviceSize offset;
+                VkDeviceSize size;
+            };
+
+            struct Block {
+                VkDeviceMemory memory{VK_NULL_HANDLE};
+                VkDeviceSize size{0};
+                VkDeviceSize used{0};
+                uint32_t memoryType{0};
+                Kind kind{Kind::Linear};
+                unsigned char* mapped{nullptr};
+                std::vector<FreeRange> freeRanges; // Sorted by offset, neighbours always merged
+            };
+
+            VkDeviceSize _blockSizeFor(uint32_t memoryType) const;
+            bool _allocateFromBlock(uint32_t blockIndex, const VkMemoryRequirements& requirements, MemoryAllocation& allocation);
+            uint32_t _createBlock(uint32_t memoryType, Kind kind, VkDeviceSize size);
+            VkDeviceMemory _allocateMemory(uint32_t memoryType, VkDeviceSize size, unsigned char** mapped);
+            void _releaseMemory(VkDeviceMemory memory, VkDeviceSize size, bool mapped);
+
+            VkDevice _device{VK_NULL_HANDLE};
+            VkPhysicalDeviceMemoryProperties _memoryProperties{};
+            VkDeviceSize _blockSize{0};
+            std::vector<Block> _blocks; // Released blocks keep their slot with a null memory handle
+
+            uint32_t _deviceAllocations{0};
+            VkDeviceSize _allocatedBytes{0};
+            VkDeviceSize _usedBytes{0};
+    };
+
+}
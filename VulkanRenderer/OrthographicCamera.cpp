@@ -37,12 +37,14 @@ void OrthographicCamera::recalculateProjection() {
     std::cout << "[CAMERA] aspectRatio, _zoomLevel: [" << _aspectRatio << ", " << _zoomLevel << "]\n";
     _projectionMatrix = glm::ortho(left, right, bottom, top, _near, _far);
     _viewProjectionMatrix = _projectionMatrix * _viewMatrix;
+    _version++;
 }
 
 void OrthographicCamera::recalculateView() {
     glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(-_position, 0.0f));
     _viewMatrix = transform;
     _viewProjectionMatrix = _projectionMatrix * _viewMatrix;
+    _version++;
 }
 
 void OrthographicCamera::zoom(float zoomDelta) {
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <VulkanRenderer_global.h>
 namespace Veloxr {
@@ -22,6 +23,8 @@ public:
 
     float getZoomLevel() const;
     glm::vec2 getPosition() const;
+    // Bumped by every change to the view or projection, compare against a stored value to detect movement.
+    inline uint64_t getVersion() const { return _version; }
 
     void setZoomLevel(float zoomLevel);
     void addToZoom(float delta);
@@ -37,6 +40,7 @@ private:
     glm::mat4 _projectionMatrix;
     glm::mat4 _viewMatrix;
     glm::mat4 _viewProjectionMatrix;
+    uint64_t _version{0};
 };
 }
 
@@ -0,0 +1,144 @@
+#include "PipelineCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace Veloxr;
+
+std::string PipelineCache::defaultDirectory() {
+    std::filesystem::path base;
+#if defined(_WIN32)
+    if (const char* localAppData = std::getenv("LOCALAPPDATA")) base = localAppData;
+#elif defined(__APPLE__)
+    if (const char* home = std::getenv("HOME")) base = std::filesystem::path(home) / "Library" / "Caches";
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        base = xdg;
+    } else if (const char* home = std::getenv("HOME")) {
+        base = std::filesystem::path(home) / ".cache";
+    }
+#endif
+    if (base.empty()) base = std::filesystem::temp_directory_path();
+    return (base / "Veloxr").string();
+}
+
+void PipelineCache::init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& directory) {
+    _device = device;
+    _loadedSize = 0;
+    vkGetPhysicalDeviceProperties(physicalDevice, &_properties);
+
+    std::error_code ec;
+    std::filesystem::path cacheDirectory = directory.empty() ? defaultDirectory() : directory;
+    std::filesystem::create_directories(cacheDirectory, ec);
+    char name[48];
+    std::snprintf(name, sizeof(name), "pipelines-%08x-%08x.vxpc", _properties.vendorID, _properties.deviceID);
+    _path = (cacheDirectory / name).string();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<uint8_t> data;
+    std::ifstream file(_path, std::ios::binary);
+    if (file) {
+        PipelineCacheHeader header{};
+        if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) && header.dataSize < (uint64_t(1) << 32)) {
+            data.resize(static_cast<size_t>(header.dataSize));
+            if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())) ||
+                !_matches(header, data.data(), data.size())) {
+                std::cout << "[PIPELINE] " << _path << " is from another device or driver, starting empty\n";
+                data.clear();
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+    if (vkCreatePipelineCache(_device, &cacheInfo, nullptr, &_cache) != VK_SUCCESS) {
+        // Some drivers refuse data they do not like rather than ignoring it
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        if (vkCreatePipelineCache(_device, &cacheInfo, nullptr, &_cache) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+        data.clear();
+    }
+    _loadedSize = data.size();
+
+    if (_loadedSize > 0) {
+        auto elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "[PIPELINE] Loaded " << _loadedSize << " bytes from " << _path << " in "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " microseconds\n";
+    }
+}
+
+bool PipelineCache::_matches(const PipelineCacheHeader& header, const uint8_t* data, size_t size) const {
+    if (header.magic != MAGIC || header.version != VERSION || header.vendorID != _properties.vendorID ||
+        header.deviceID != _properties.deviceID || header.driverVersion != _properties.driverVersion ||
+        std::memcmp(header.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        return false;
+    }
+
+    // The driver's own VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, UUID
+    constexpr size_t driverHeaderSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if (size < driverHeaderSize) return false;
+    uint32_t fields[4];
+    std::memcpy(fields, data, sizeof(fields));
+    return fields[0] >= driverHeaderSize && fields[0] <= size && fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        fields[2] == _properties.vendorID && fields[3] == _properties.deviceID &&
+        std::memcmp(data + sizeof(fields), _properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::save() {
+    if (_cache == VK_NULL_HANDLE || _path.empty()) return;
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(_device, _cache, &size, nullptr) != VK_SUCCESS || size == 0 || size == _loadedSize) return;
+    std::vector<uint8_t> data(size);
+    if (vkGetPipelineCacheData(_device, _cache, &size, data.data()) != VK_SUCCESS) return;
+    data.resize(size);
+
+    PipelineCacheHeader header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.vendorID = _properties.vendorID;
+    header.deviceID = _properties.deviceID;
+    header.driverVersion = _properties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+
+    // Written aside and renamed over, another instance may be reading the old file
+    std::string temporary = _path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            std::cerr << "[PIPELINE] Could not write " << temporary << std::endl;
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temporary, _path, ec);
+    if (ec) {
+        std::cerr << "[PIPELINE] Could not replace " << _path << ": " << ec.message() << std::endl;
+        std::filesystem::remove(temporary, ec);
+        return;
+    }
+    _loadedSize = data.size();
+    std::cout << "[PIPELINE] Saved " << data.size() << " bytes to " << _path << "\n";
+}
+
+void PipelineCache::destroy() {
+    if (_cache != VK_NULL_HANDLE) {
+        vkDestroyPipelineCache(_device, _cache, nullptr);
+        _cache = VK_NULL_HANDLE;
+    }
+    _device = VK_NULL_HANDLE;
+    _loadedSize = 0;
+}
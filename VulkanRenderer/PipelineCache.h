@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vulkan/vulkan.h>
+#include <VulkanRenderer_global.h>
+
+namespace Veloxr {
+
+    // Written in front of the driver's cache data. A file from another GPU or driver is ignored, the
+    // driver would reject most of those itself but some crash on foreign data instead.
+    struct PipelineCacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+    };
+
+    // A VkPipelineCache that survives restarts, one file per device in a per-user cache directory.
+    class VULKANRENDERER_EXPORT PipelineCache {
+
+        public:
+            PipelineCache() = default;
+
+            // Never throws on a missing, stale or unreadable file, the cache then starts empty.
+            // An empty directory picks defaultDirectory().
+            void init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& directory = "");
+            // Writes the cache back if pipelines were added since it was loaded, errors are only logged.
+            void save();
+            void destroy();
+
+            inline VkPipelineCache get() const { return _cache; }
+            inline bool wasLoaded() const { return _loadedSize > 0; }
+            inline const std::string& getPath() const { return _path; }
+
+            // $XDG_CACHE_HOME, ~/.cache, ~/Library/Caches or %LOCALAPPDATA%, followed by Veloxr.
+            static std::string defaultDirectory();
+
+        private:
+            static constexpr uint32_t MAGIC = 0x43505856; // "VXPC"
+            static constexpr uint32_t VERSION = 1;
+
+            bool _matches(const PipelineCacheHeader& header, const uint8_t* data, size_t size) const;
+
+            VkDevice _device{VK_NULL_HANDLE};
+            VkPipelineCache _cache{VK_NULL_HANDLE};
+            VkPhysicalDeviceProperties _properties{};
+            std::string _path;
+            size_t _loadedSize{0};
+    };
+
+}
@@ -0,0 +1,459 @@
+#include "PixelConversion.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VELOXR_PIXEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define VELOXR_TARGET(isa)
+#else
+#define VELOXR_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define VELOXR_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+using namespace Veloxr;
+
+namespace {
+    using ExpandKernel = void (*)(const unsigned char* src, unsigned char* dst, size_t pixels);
+    using NarrowKernel = void (*)(const uint16_t* src, unsigned char* dst, size_t samples);
+    using HalveKernel  = void (*)(const unsigned char* row0, const unsigned char* row1, unsigned char* dst, size_t srcPixels);
+
+    struct Kernels {
+        ExpandKernel gray;
+        ExpandKernel grayAlpha;
+        ExpandKernel rgb;
+        NarrowKernel narrow;
+        HalveKernel  halve;
+    };
+
+    // Scalar, also handles the tails the vector loops leave behind.
+
+    void grayScalar(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        for (size_t i = 0; i < pixels; i++) {
+            unsigned char g = src[i];
+            dst[i * 4 + 0] = g;
+            dst[i * 4 + 1] = g;
+            dst[i * 4 + 2] = g;
+            dst[i * 4 + 3] = 255;
+        }
+    }
+
+    void grayAlphaScalar(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        for (size_t i = 0; i < pixels; i++) {
+            unsigned char g = src[i * 2];
+            dst[i * 4 + 0] = g;
+            dst[i * 4 + 1] = g;
+            dst[i * 4 + 2] = g;
+            dst[i * 4 + 3] = src[i * 2 + 1];
+        }
+    }
+
+    void rgbScalar(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        for (size_t i = 0; i < pixels; i++) {
+            dst[i * 4 + 0] = src[i * 3 + 0];
+            dst[i * 4 + 1] = src[i * 3 + 1];
+            dst[i * 4 + 2] = src[i * 3 + 2];
+            dst[i * 4 + 3] = 255;
+        }
+    }
+
+    void narrowScalar(const uint16_t* src, unsigned char* dst, size_t samples) {
+        for (size_t i = 0; i < samples; i++) {
+            dst[i] = static_cast<unsigned char>((src[i] * 255u + 32895u) >> 16);
+        }
+    }
+
+    // Rounded 2x2 average, an odd last pixel averages the two rows of its column.
+    void halveScalar(const unsigned char* row0, const unsigned char* row1, unsigned char* dst, size_t srcPixels) {
+        size_t pairs = srcPixels / 2;
+        for (size_t i = 0; i < pairs; i++) {
+            for (size_t c = 0; c < 4; c++) {
+                uint32_t sum = row0[i * 8 + c] + row0[i * 8 + 4 + c] + row1[i * 8 + c] + row1[i * 8 + 4 + c];
+                dst[i * 4 + c] = static_cast<unsigned char>((sum + 2) >> 2);
+            }
+        }
+        if (srcPixels & 1) {
+            for (size_t c = 0; c < 4; c++) {
+                dst[pairs * 4 + c] = static_cast<unsigned char>((row0[pairs * 8 + c] + row1[pairs * 8 + c] + 1) >> 1);
+            }
+        }
+    }
+
+    constexpr Kernels SCALAR_KERNELS{grayScalar, grayAlphaScalar, rgbScalar, narrowScalar, halveScalar};
+
+#if defined(VELOXR_PIXEL_X86)
+
+    // SSE4.1 paths, the shuffles only need SSSE3 but every x86 CPU with one has the other.
+
+    VELOXR_TARGET("sse4.1") void graySSE4(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m128i m0 = _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+        const __m128i m1 = _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+        const __m128i m2 = _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1);
+        const __m128i m3 = _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+            _mm_storeu_si128(out + 0, _mm_or_si128(_mm_shuffle_epi8(g, m0), alpha));
+            _mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(g, m1), alpha));
+            _mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(g, m2), alpha));
+            _mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(g, m3), alpha));
+        }
+        grayScalar(src + i, dst + i * 4, pixels - i);
+    }
+
+    VELOXR_TARGET("sse4.1") void grayAlphaSSE4(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        const __m128i m0 = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+        const __m128i m1 = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+        size_t i = 0;
+        for (; i + 8 <= pixels; i += 8) {
+            __m128i ga = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+            __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+            _mm_storeu_si128(out + 0, _mm_shuffle_epi8(ga, m0));
+            _mm_storeu_si128(out + 1, _mm_shuffle_epi8(ga, m1));
+        }
+        grayAlphaScalar(src + i * 2, dst + i * 4, pixels - i);
+    }
+
+    // 16 pixels from three loads, realigned so every shuffle sees four whole RGB triples.
+    VELOXR_TARGET("sse4.1") void rgbSSE4(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m128i mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            const __m128i* in = reinterpret_cast<const __m128i*>(src + i * 3);
+            __m128i a = _mm_loadu_si128(in + 0);
+            __m128i b = _mm_loadu_si128(in + 1);
+            __m128i c = _mm_loadu_si128(in + 2);
+            __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+            _mm_storeu_si128(out + 0, _mm_or_si128(_mm_shuffle_epi8(a, mask), alpha));
+            _mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), mask), alpha));
+            _mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), mask), alpha));
+            _mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), mask), alpha));
+        }
+        rgbScalar(src + i * 3, dst + i * 4, pixels - i);
+    }
+
+    // round(v / 257) without widening: (x - (x >> 8)) >> 8 with x = v + 128, saturated.
+    VELOXR_TARGET("sse4.1") void narrowSSE4(const uint16_t* src, unsigned char* dst, size_t samples) {
+        const __m128i bias = _mm_set1_epi16(128);
+        size_t i = 0;
+        for (; i + 16 <= samples; i += 16) {
+            __m128i a = _mm_adds_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), bias);
+            __m128i b = _mm_adds_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)), bias);
+            a = _mm_srli_epi16(_mm_sub_epi16(a, _mm_srli_epi16(a, 8)), 8);
+            b = _mm_srli_epi16(_mm_sub_epi16(b, _mm_srli_epi16(b, 8)), 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+        }
+        narrowScalar(src + i, dst + i, samples - i);
+    }
+
+    // AVX2 shuffles stay within 128-bit lanes, so each lane gets its own copy of the source.
+
+    VELOXR_TARGET("avx2") void grayAVX2(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m256i m0 = _mm256_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+                                            4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+        const __m256i m1 = _mm256_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1,
+                                            12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            __m256i g = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+            __m256i* out = reinterpret_cast<__m256i*>(dst + i * 4);
+            _mm256_storeu_si256(out + 0, _mm256_or_si256(_mm256_shuffle_epi8(g, m0), alpha));
+            _mm256_storeu_si256(out + 1, _mm256_or_si256(_mm256_shuffle_epi8(g, m1), alpha));
+        }
+        grayScalar(src + i, dst + i * 4, pixels - i);
+    }
+
+    VELOXR_TARGET("avx2") void grayAlphaAVX2(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        const __m256i mask = _mm256_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7,
+                                              8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            const __m128i* in = reinterpret_cast<const __m128i*>(src + i * 2);
+            __m256i a = _mm256_broadcastsi128_si256(_mm_loadu_si128(in + 0));
+            __m256i b = _mm256_broadcastsi128_si256(_mm_loadu_si128(in + 1));
+            __m256i* out = reinterpret_cast<__m256i*>(dst + i * 4);
+            _mm256_storeu_si256(out + 0, _mm256_shuffle_epi8(a, mask));
+            _mm256_storeu_si256(out + 1, _mm256_shuffle_epi8(b, mask));
+        }
+        grayAlphaScalar(src + i * 2, dst + i * 4, pixels - i);
+    }
+
+    // 8 pixels per 32 byte load, dwords 0-2 and 3-5 are spread to the two lanes before the shuffle.
+    VELOXR_TARGET("avx2") void rgbAVX2(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m256i spread = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+        const __m256i mask = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                              0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        size_t i = 0;
+        for (; (pixels - i) * 3 >= 32 + 24; i += 16) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 3));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 3 + 24));
+            a = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(a, spread), mask);
+            b = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(b, spread), mask);
+            __m256i* out = reinterpret_cast<__m256i*>(dst + i * 4);
+            _mm256_storeu_si256(out + 0, _mm256_or_si256(a, alpha));
+            _mm256_storeu_si256(out + 1, _mm256_or_si256(b, alpha));
+        }
+        rgbSSE4(src + i * 3, dst + i * 4, pixels - i);
+    }
+
+    VELOXR_TARGET("avx2") void narrowAVX2(const uint16_t* src, unsigned char* dst, size_t samples) {
+        const __m256i bias = _mm256_set1_epi16(128);
+        size_t i = 0;
+        for (; i + 32 <= samples; i += 32) {
+            __m256i a = _mm256_adds_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), bias);
+            __m256i b = _mm256_adds_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16)), bias);
+            a = _mm256_srli_epi16(_mm256_sub_epi16(a, _mm256_srli_epi16(a, 8)), 8);
+            b = _mm256_srli_epi16(_mm256_sub_epi16(b, _mm256_srli_epi16(b, 8)), 8);
+            // packus interleaves the lanes, put the quadwords back in order.
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+        }
+        narrowSSE4(src + i, dst + i, samples - i);
+    }
+
+    // 8 source pixels to 4, widened to 16 bits so the rounding matches the scalar path exactly.
+    VELOXR_TARGET("sse4.1") void halveSSE4(const unsigned char* row0, const unsigned char* row1, unsigned char* dst, size_t srcPixels) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        size_t pairs = srcPixels / 2;
+        size_t i = 0;
+        for (; i + 4 <= pairs; i += 4) {
+            __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i * 8));
+            __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i * 8 + 16));
+            __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i * 8));
+            __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i * 8 + 16));
+            // Column sums, two pixels per register
+            __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+            // Each pixel plus its right neighbour lands in the low half
+            s01 = _mm_add_epi16(s01, _mm_srli_si128(s01, 8));
+            s23 = _mm_add_epi16(s23, _mm_srli_si128(s23, 8));
+            s45 = _mm_add_epi16(s45, _mm_srli_si128(s45, 8));
+            s67 = _mm_add_epi16(s67, _mm_srli_si128(s67, 8));
+            __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s01, s23), two), 2);
+            __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s45, s67), two), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(lo, hi));
+        }
+        halveScalar(row0 + i * 8, row1 + i * 8, dst + i * 4, srcPixels - i * 2);
+    }
+
+    // Box filtering is bound by memory, not by the width of the adds, so AVX2 shares the SSE4.1 kernel.
+    constexpr Kernels SSE4_KERNELS{graySSE4, grayAlphaSSE4, rgbSSE4, narrowSSE4, halveSSE4};
+    constexpr Kernels AVX2_KERNELS{grayAVX2, grayAlphaAVX2, rgbAVX2, narrowAVX2, halveSSE4};
+
+    bool cpuHasSSE4() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 9)) && (info[2] & (1 << 19)); // SSSE3, SSE4.1
+#else
+        return __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1");
+#endif
+    }
+
+    bool cpuHasAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6; // OSXSAVE, XMM and YMM state
+        if (!osSavesYmm) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+#elif defined(VELOXR_PIXEL_NEON)
+
+    // Structured loads and stores do the (de)interleaving, 16 pixels at a time.
+
+    void grayNEON(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        const uint8x16_t alpha = vdupq_n_u8(255);
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            uint8x16_t g = vld1q_u8(src + i);
+            uint8x16x4_t rgba = {{g, g, g, alpha}};
+            vst4q_u8(dst + i * 4, rgba);
+        }
+        grayScalar(src + i, dst + i * 4, pixels - i);
+    }
+
+    void grayAlphaNEON(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            uint8x16x2_t ga = vld2q_u8(src + i * 2);
+            uint8x16x4_t rgba = {{ga.val[0], ga.val[0], ga.val[0], ga.val[1]}};
+            vst4q_u8(dst + i * 4, rgba);
+        }
+        grayAlphaScalar(src + i * 2, dst + i * 4, pixels - i);
+    }
+
+    void rgbNEON(const unsigned char* src, unsigned char* dst, size_t pixels) {
+        const uint8x16_t alpha = vdupq_n_u8(255);
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+            uint8x16x4_t rgba = {{rgb.val[0], rgb.val[1], rgb.val[2], alpha}};
+            vst4q_u8(dst + i * 4, rgba);
+        }
+        rgbScalar(src + i * 3, dst + i * 4, pixels - i);
+    }
+
+    void narrowNEON(const uint16_t* src, unsigned char* dst, size_t samples) {
+        const uint16x8_t bias = vdupq_n_u16(128);
+        size_t i = 0;
+        for (; i + 16 <= samples; i += 16) {
+            uint16x8_t a = vqaddq_u16(vld1q_u16(src + i), bias);
+            uint16x8_t b = vqaddq_u16(vld1q_u16(src + i + 8), bias);
+            a = vsubq_u16(a, vshrq_n_u16(a, 8));
+            b = vsubq_u16(b, vshrq_n_u16(b, 8));
+            vst1q_u8(dst + i, vcombine_u8(vshrn_n_u16(a, 8), vshrn_n_u16(b, 8)));
+        }
+        narrowScalar(src + i, dst + i, samples - i);
+    }
+
+    // 16 source pixels to 8, deinterleaved so pairwise adds combine horizontal neighbours.
+    void halveNEON(const unsigned char* row0, const unsigned char* row1, unsigned char* dst, size_t srcPixels) {
+        size_t pairs = srcPixels / 2;
+        size_t i = 0;
+        for (; i + 8 <= pairs; i += 8) {
+            uint8x8x4_t a0 = vld4_u8(row0 + i * 8);
+            uint8x8x4_t a1 = vld4_u8(row0 + i * 8 + 32);
+            uint8x8x4_t b0 = vld4_u8(row1 + i * 8);
+            uint8x8x4_t b1 = vld4_u8(row1 + i * 8 + 32);
+            uint8x8x4_t out;
+            for (int c = 0; c < 4; c++) {
+                uint16x8_t lo = vaddl_u8(a0.val[c], b0.val[c]);
+                uint16x8_t hi = vaddl_u8(a1.val[c], b1.val[c]);
+                uint16x8_t sum = vcombine_u16(vpadd_u16(vget_low_u16(lo), vget_high_u16(lo)),
+                                              vpadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+                out.val[c] = vrshrn_n_u16(sum, 2);
+            }
+            vst4_u8(dst + i * 4, out);
+        }
+        halveScalar(row0 + i * 8, row1 + i * 8, dst + i * 4, srcPixels - i * 2);
+    }
+
+    constexpr Kernels NEON_KERNELS{grayNEON, grayAlphaNEON, rgbNEON, narrowNEON, halveNEON};
+
+#endif
+
+    std::atomic<int> activePath{-1};
+
+    PixelConversion::Path detectPath() {
+        if (PixelConversion::isSupported(PixelConversion::Path::AVX2)) return PixelConversion::Path::AVX2;
+        if (PixelConversion::isSupported(PixelConversion::Path::SSE4)) return PixelConversion::Path::SSE4;
+        if (PixelConversion::isSupported(PixelConversion::Path::NEON)) return PixelConversion::Path::NEON;
+        return PixelConversion::Path::Scalar;
+    }
+
+    const Kernels& kernels() {
+        switch (PixelConversion::getPath()) {
+#if defined(VELOXR_PIXEL_X86)
+            case PixelConversion::Path::AVX2: return AVX2_KERNELS;
+            case PixelConversion::Path::SSE4: return SSE4_KERNELS;
+#elif defined(VELOXR_PIXEL_NEON)
+            case PixelConversion::Path::NEON: return NEON_KERNELS;
+#endif
+            default: return SCALAR_KERNELS;
+        }
+    }
+}
+
+PixelConversion::Path PixelConversion::getPath() {
+    int path = activePath.load(std::memory_order_relaxed);
+    if (path < 0) {
+        path = static_cast<int>(detectPath());
+        activePath.store(path, std::memory_order_relaxed);
+    }
+    return static_cast<Path>(path);
+}
+
+bool PixelConversion::isSupported(Path path) {
+    switch (path) {
+        case Path::Scalar: return true;
+#if defined(VELOXR_PIXEL_X86)
+        case Path::SSE4: return cpuHasSSE4();
+        case Path::AVX2: return cpuHasSSE4() && cpuHasAVX2();
+#elif defined(VELOXR_PIXEL_NEON)
+        case Path::NEON: return true;
+#endif
+        default: return false;
+    }
+}
+
+bool PixelConversion::setPath(Path path) {
+    if (!isSupported(path)) return false;
+    activePath.store(static_cast<int>(path), std::memory_order_relaxed);
+    return true;
+}
+
+const char* PixelConversion::pathName(Path path) {
+    switch (path) {
+        case Path::SSE4: return "SSE4";
+        case Path::AVX2: return "AVX2";
+        case Path::NEON: return "NEON";
+        default: return "Scalar";
+    }
+}
+
+void PixelConversion::toRGBA8(const unsigned char* src, unsigned char* dst, size_t pixels, uint32_t channels) {
+    switch (channels) {
+        case 0: return;
+        case 1: kernels().gray(src, dst, pixels); return;
+        case 2: kernels().grayAlpha(src, dst, pixels); return;
+        case 3: kernels().rgb(src, dst, pixels); return;
+        case 4: std::memcpy(dst, src, pixels * 4); return;
+        default:
+            for (size_t i = 0; i < pixels; i++) std::memcpy(dst + i * 4, src + i * channels, 4);
+            return;
+    }
+}
+
+void PixelConversion::halveRGBA8(const unsigned char* row0, const unsigned char* row1, unsigned char* dst, size_t srcPixels) {
+    kernels().halve(row0, row1, dst, srcPixels);
+}
+
+void PixelConversion::narrow16To8(const uint16_t* src, unsigned char* dst, size_t samples) {
+    kernels().narrow(src, dst, samples);
+}
+
+// Narrowed in cache sized chunks so the expand pass reads what the narrow pass just wrote.
+void PixelConversion::toRGBA8(const uint16_t* src, unsigned char* dst, size_t pixels, uint32_t channels) {
+    if (channels == 0) return;
+    constexpr size_t CHUNK_SAMPLES = 4096;
+    unsigned char narrowed[CHUNK_SAMPLES];
+    size_t chunkPixels = std::max<size_t>(1, CHUNK_SAMPLES / channels);
+    if (chunkPixels * channels > CHUNK_SAMPLES) {
+        // More channels than fit a chunk, only the first four are kept anyway.
+        for (size_t i = 0; i < pixels; i++) narrowScalar(src + i * channels, dst + i * 4, 4);
+        return;
+    }
+    for (size_t i = 0; i < pixels; i += chunkPixels) {
+        size_t count = std::min(chunkPixels, pixels - i);
+        narrow16To8(src + i * channels, narrowed, count * channels);
+        toRGBA8(narrowed, dst + i * 4, count, channels);
+    }
+}
+
+void PixelConversion::toRGBA8(const void* src, uint32_t sampleBytes, unsigned char* dst, size_t pixels, uint32_t channels) {
+    if (sampleBytes == 2) {
+        toRGBA8(static_cast<const uint16_t*>(src), dst, pixels, channels);
+    } else {
+        toRGBA8(static_cast<const unsigned char*>(src), dst, pixels, channels);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <VulkanRenderer_global.h>
+
+namespace Veloxr {
+
+    // Expands decoded scanlines to the RGBA8 every tile and texture uses.
+    // 1 channel is gray, 2 is gray plus alpha, 3 is RGB, 4 or more keeps the first four.
+    // The fastest path the CPU supports is picked on first use, setPath() overrides it.
+    class VULKANRENDERER_EXPORT PixelConversion {
+
+        public:
+            enum class Path { Scalar, SSE4, AVX2, NEON };
+
+            static void toRGBA8(const unsigned char* src, unsigned char* dst, size_t pixels, uint32_t channels);
+            // 16-bit samples are rounded to the nearest 8-bit value, v * 255 / 65535.
+            static void toRGBA8(const uint16_t* src, unsigned char* dst, size_t pixels, uint32_t channels);
+            // For rows read with OIIO, sampleBytes is 1 for UINT8 and 2 for UINT16.
+            static void toRGBA8(const void* src, uint32_t sampleBytes, unsigned char* dst, size_t pixels, uint32_t channels);
+
+            static void narrow16To8(const uint16_t* src, unsigned char* dst, size_t samples);
+
+            // 2x2 box filter of two RGBA8 rows into (srcPixels + 1) / 2 pixels, rounded to nearest.
+            // An odd last pixel averages its column, pass the same row twice for an odd last row.
+            static void halveRGBA8(const unsigned char* row0, const unsigned char* row1, unsigned char* dst, size_t srcPixels);
+
+            static Path getPath();
+            static bool isSupported(Path path);
+            // Returns false and keeps the current path when the CPU cannot run it.
+            static bool setPath(Path path);
+            static const char* pathName(Path path);
+    };
+
+}
@@ -0,0 +1,71 @@
+#include "StagingRing.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Veloxr;
+
+void StagingRing::init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator& allocator, VkDeviceSize capacity) {
+    _device = device;
+    _allocator = &allocator;
+    _capacity = capacity;
+    _head = 0;
+    _allocated = 0;
+    _released = 0;
+
+    // Block size for BC7 copies (a multiple of the BC1 and RGBA8 texel), raised to what the driver prefers for buffer offsets.
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    _alignment = std::max<VkDeviceSize>(16, properties.limits.optimalBufferCopyOffsetAlignment);
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = capacity;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(_device, &bufferInfo, nullptr, &_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create staging ring buffer!");
+    }
+
+    // Host visible allocations come back persistently mapped.
+    _memory = _allocator->allocateForBuffer(_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    _mapped = _memory.mapped;
+
+    std::cout << "[STAGING] Ring of " << (capacity / 1024.0 / 1024.0) << " MB, alignment " << _alignment << "\n";
+}
+
+void StagingRing::destroy() {
+    if (_device == VK_NULL_HANDLE) return;
+    vkDestroyBuffer(_device, _buffer, nullptr);
+    _allocator->free(_memory);
+    _mapped = nullptr;
+    _buffer = VK_NULL_HANDLE;
+    _allocator = nullptr;
+    _device = VK_NULL_HANDLE;
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize& offset) {
+    if (size > _capacity) return false;
+    // Nothing in flight, start from the beginning so a large upload does not have to wrap.
+    if (getUsed() == 0) _head = 0;
+
+    VkDeviceSize aligned = (_head + _alignment - 1) / _alignment * _alignment;
+    VkDeviceSize start = aligned;
+    VkDeviceSize padding = aligned - _head;
+    if (aligned + size > _capacity) {
+        // Does not fit before the end, skip the tail and start over at zero.
+        start = 0;
+        padding = _capacity - _head;
+    }
+
+    if (getUsed() + padding + size > _capacity) return false;
+
+    offset = start;
+    _head = start + size;
+    _allocated += padding + size;
+    return true;
+}
+
+void StagingRing::release(uint64_t marker) {
+    _released = std::max(_released, std::min(marker, _allocated));
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+#include <MemoryAllocator.h>
+#include <VulkanRenderer_global.h>
+
+namespace Veloxr {
+
+    // One persistently mapped host-visible buffer used as a FIFO for upload staging.
+    // Allocations are released in the order they were made, once the GPU is done with them.
+    class VULKANRENDERER_EXPORT StagingRing {
+
+        public:
+            StagingRing() = default;
+            // The memory comes from allocator, which has to outlive the ring.
+            void init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator& allocator, VkDeviceSize capacity);
+            void destroy();
+
+            // Returns false when there is no room left, the caller should retry after release().
+            bool allocate(VkDeviceSize size, VkDeviceSize& offset);
+
+            // Everything allocated before marker() was called is free again.
+            inline uint64_t marker() const { return _allocated; }
+            void release(uint64_t marker);
+
+            inline VkBuffer getBuffer() const { return _buffer; }
+            inline unsigned char* getMapped() const { return _mapped; }
+            inline VkDeviceSize getCapacity() const { return _capacity; }
+            inline VkDeviceSize getUsed() const { return static_cast<VkDeviceSize>(_allocated - _released); }
+
+        private:
+            VkDevice _device{VK_NULL_HANDLE};
+            MemoryAllocator* _allocator{nullptr};
+            VkBuffer _buffer{VK_NULL_HANDLE};
+            MemoryAllocation _memory{};
+            unsigned char* _mapped{nullptr};
+            VkDeviceSize _capacity{0};
+            VkDeviceSize _alignment{16};
+            VkDeviceSize _head{0};
+            // Running byte totals, including padding skipped at the end when wrapping.
+            uint64_t _allocated{0};
+            uint64_t _released{0};
+    };
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <TextureTiling.h>
+#include <TileResidency.h>
+
+namespace Veloxr {
+
+    // Size and modification time of an image file, the same check TileCache makes against its source.
+    struct SourceStamp {
+        uint64_t size{0};
+        int64_t modified{0};
+
+        bool operator==(const SourceStamp& other) const { return size == other.size && modified == other.modified; }
+
+        // Both stay 0 for a file that cannot be read.
+        static SourceStamp of(const std::string& path) {
+            SourceStamp stamp{};
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(path, ec);
+            if (ec) return stamp;
+            auto modified = std::filesystem::last_write_time(path, ec);
+            if (ec) return stamp;
+            stamp.size = size;
+            stamp.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+            return stamp;
+        }
+    };
+
+    // Resident tiles of images that are no longer on screen, so flipping back to one is instant.
+    // Bookkeeping only: Tile is whatever the renderer keeps per tile, and everything trim() or
+    // take() hands back is the caller's to release.
+    template <typename Tile>
+    class TexturePool {
+
+        public:
+            struct Entry {
+                TileKey key;
+                Tile tile;
+                uint64_t bytes;
+                uint64_t lastUsed; // Residency frame, only comparable within one image
+            };
+
+            // Keeps the tiles of an image that just left the screen, it becomes the most recently viewed.
+            // source is the file as it was when the tiles were decoded. Tiles are only reusable with the
+            // same format and tile size from an unchanged file, take() checks. The image must not be
+            // parked already, opening it takes it out.
+            void park(const std::string& image, const SourceStamp& source, TileFormat format, uint32_t tileSize, std::vector<Entry> tiles) {
+                if (tiles.empty()) return;
+
+                Image& parked = _images[image];
+                parked.source = source;
+                parked.format = format;
+                parked.tileSize = tileSize;
+                parked.viewed = ++_clock;
+                parked.coarsestLevel = 0;
+                for (const Entry& entry : tiles) {
+                    parked.coarsestLevel = std::max(parked.coarsestLevel, entry.key.level);
+                    _bytes += entry.bytes;
+                }
+                _tileCount += static_cast<uint32_t>(tiles.size());
+                parked.tiles = std::move(tiles);
+            }
+
+            // Removes the image and returns true if its tiles fit format and tileSize and the file is the one
+            // they were decoded from. Otherwise they are still handed back in tiles, for release.
+            bool take(const std::string& image, const SourceStamp& source, TileFormat format, uint32_t tileSize, std::vector<Entry>& tiles) {
+                tiles.clear();
+                auto it = _images.find(image);
+                if (it == _images.end()) return false;
+                bool compatible = it->second.source == source && source.size != 0 &&
+                    it->second.format == format && it->second.tileSize == tileSize;
+                tiles = std::move(it->second.tiles);
+                for (const Entry& entry : tiles) _bytes -= entry.bytes;
+                _tileCount -= static_cast<uint32_t>(tiles.size());
+                _images.erase(it);
+                return compatible;
+            }
+
+            // Evicts until both limits hold: least recently viewed image first and within it the least
+            // recently used tiles, finest level first. Coarsest tiles go last, they alone make a switch
+            // back show the whole image straight away.
+            std::vector<Tile> trim(uint64_t maxBytes, uint32_t maxTiles) {
+                std::vector<Tile> evicted;
+                if (_bytes <= maxBytes && _tileCount <= maxTiles) return evicted;
+
+                // Ascending on every field: not coarsest first, then oldest view, finest level, oldest use
+                using Rank = std::tuple<bool, uint64_t, uint32_t, uint64_t>;
+                std::vector<std::pair<Rank, std::pair<std::string, size_t>>> order;
+                order.reserve(_tileCount);
+                for (const auto& [name, parked] : _images) {
+                    for (size_t i = 0; i < parked.tiles.size(); i++) {
+                        const Entry& entry = parked.tiles[i];
+                        Rank rank{entry.key.level == parked.coarsestLevel, parked.viewed, entry.key.level, entry.lastUsed};
+                        order.push_back({rank, {name, i}});
+                    }
+                }
+                std::sort(order.begin(), order.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+
+                std::unordered_map<std::string, std::vector<bool>> removed;
+                for (const auto& [rank, location] : order) {
+                    if (_bytes <= maxBytes && _tileCount <= maxTiles) break;
+                    Entry& entry = _images[location.first].tiles[location.second];
+                    std::vector<bool>& flags = removed[location.first];
+                    flags.resize(_images[location.first].tiles.size(), false);
+                    flags[location.second] = true;
+                    _bytes -= entry.bytes;
+                    _tileCount--;
+                    evicted.push_back(std::move(entry.tile));
+                }
+
+                for (auto& [name, flags] : removed) {
+                    std::vector<Entry>& tiles = _images[name].tiles;
+                    size_t kept = 0;
+                    for (size_t i = 0; i < tiles.size(); i++) {
+                        if (!flags[i]) tiles[kept++] = std::move(tiles[i]);
+                    }
+                    tiles.resize(kept);
+                    if (tiles.empty()) _images.erase(name);
+                }
+                return evicted;
+            }
+
+            std::vector<Tile> clear() {
+                std::vector<Tile> evicted;
+                for (auto& [name, parked] : _images) {
+                    for (Entry& entry : parked.tiles) evicted.push_back(std::move(entry.tile));
+                }
+                _images.clear();
+                _bytes = 0;
+                _tileCount = 0;
+                return evicted;
+            }
+
+            template <typename F>
+            void forEachTile(F&& visit) const {
+                for (const auto& [name, parked] : _images) {
+                    for (const Entry& entry : parked.tiles) visit(entry.tile);
+                }
+            }
+
+            inline bool contains(const std::string& image) const { return _images.count(image) > 0; }
+            inline uint64_t getBytes() const { return _bytes; }
+            inline uint32_t getTileCount() const { return _tileCount; }
+            inline size_t getImageCount() const { return _images.size(); }
+
+        private:
+            struct Image {
+                SourceStamp source;
+                TileFormat format;
+                uint32_t tileSize;
+                uint64_t viewed;        // Park order, larger is more recent
+                uint32_t coarsestLevel;
+                std::vector<Entry> tiles;
+            };
+
+            std::unordered_map<std::string, Image> _images;
+            uint64_t _bytes{0};
+            uint32_t _tileCount{0};
+            uint64_t _clock{0};
+    };
+
+}
@@ -1,12 +1,17 @@
 #include "TextureTiling.h"
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/imagebuf.h>
+#include <PixelConversion.h>
+#include <ThreadPool.h>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 
 using namespace Veloxr;
 OIIO_NAMESPACE_USING  
 
-TiledResult TextureTiling::tile4(OIIOTexture &texture, uint32_t maxResolution){
+TiledResult TextureTiling::tile4(OIIOTexture &texture, uint64_t maxResolution){
     // n^2 * ~4k < 25*4k: Fit tiles into 100,000x100,000
     static std::vector<int> TILES = {1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121};
 
@@ -19,7 +24,7 @@ TiledResult TextureTiling::tile4(OIIOTexture &texture, uint32_t maxResolution){
 
     uint32_t w = texture.getResolution().x;
     uint32_t h = texture.getResolution().y;
-    uint32_t totalPixels = w * h;
+    uint64_t totalPixels = texture.getResolution().area();
 
     if (totalPixels <= maxResolution) {
         TextureData one;
@@ -54,8 +59,8 @@ TiledResult TextureTiling::tile4(OIIOTexture &texture, uint32_t maxResolution){
     double ratio = (double)totalPixels / (double)maxResolution;
     double exactN = std::sqrt(ratio);
     int N = (int)std::ceil(exactN);
-    uint32_t tileW = (w + N - 1) / N;
-    uint32_t tileH = (h + N - 1) / N;
+    uint32_t tileW = static_cast<uint32_t>((static_cast<uint64_t>(w) + N - 1) / N);
+    uint32_t tileH = static_cast<uint32_t>((static_cast<uint64_t>(h) + N - 1) / N);
 
     std::cout << "[Tiler] tileW, tileH: " << tileW << ", " << tileH << std::endl;
     std::cout << "[Tiler] Ratio: " << ratio << std::endl;
@@ -71,13 +76,11 @@ TiledResult TextureTiling::tile4(OIIOTexture &texture, uint32_t maxResolution){
     std::vector<TextureData> tileResults(totalTiles);
     std::vector<std::vector<Vertex>> vertexResults(totalTiles);
 
-    int numThreads = 16;
-    int tilesPerThread = (totalTiles + numThreads - 1) / numThreads;
-    std::vector<std::thread> threads;
-    for (int t = 0; t < numThreads; t++) {
-        int start = t * tilesPerThread;
-        int end = std::min(totalTiles, start + tilesPerThread);
-        threads.push_back(std::thread([=, &tileResults, &vertexResults, &w, &h, &tileW, &tileH, &stepX, &stepY]() {
+    // One task per tile on the shared pool, idle workers steal what is left so slow tiles do not hold up a fixed slice.
+    TaskGroup group;
+    for (int start = 0; start < totalTiles; start++) {
+        int end = start + 1;
+        group.run([=, &tileResults, &vertexResults, &w, &h, &tileW, &tileH, &stepX, &stepY]() {
             std::unique_ptr<OIIO::ImageInput> in = OIIO::ImageInput::open(filename);
             if (!in) {
                 std::cerr << "Thread: Could not open file: " << filename << std::endl;
@@ -86,6 +89,8 @@ TiledResult TextureTiling::tile4(OIIOTexture &texture, uint32_t maxResolution){
             const OIIO::ImageSpec &spec = in->spec();
             uint32_t originalChannels = spec.nchannels;
             uint32_t forcedChannels   = 4;
+            uint32_t sampleBytes      = spec.format == OIIO::TypeDesc::UINT16 ? 2 : 1;
+            OIIO::TypeDesc readFormat = sampleBytes == 2 ? OIIO::TypeDesc::UINT16 : OIIO::TypeDesc::UINT8;
 
             for (int idx = start; idx < end; idx++) {
                 int row = idx / N;
@@ -99,26 +104,19 @@ TiledResult TextureTiling::tile4(OIIOTexture &texture, uint32_t maxResolution){
                 if (thisTileW <= 0 || thisTileH <= 0) {
                     continue;
                 }
-                std::vector<unsigned char> tileData(thisTileW * thisTileH * forcedChannels, 255);
-                std::vector<unsigned char> rowBuffer(w * originalChannels);
-                std::vector<unsigned char> rgbaRow(w * forcedChannels, 255);
+                std::vector<unsigned char> tileData(static_cast<size_t>(thisTileW) * thisTileH * forcedChannels, 255);
+                std::vector<unsigned char> rowBuffer(static_cast<size_t>(w) * originalChannels * sampleBytes);
 
                 for (int yy = y0; yy < (int)y1; yy++) {
-                    bool ok = in->read_scanline(yy, 0, OIIO::TypeDesc::UINT8, rowBuffer.data());
+                    bool ok = in->read_scanline(yy, 0, readFormat, rowBuffer.data());
                     if (!ok) {
                         std::cerr << "Thread error reading scanline " << yy << ": " << in->geterror() << std::endl;
                         break;
                     }
-                    for (int x = 0; x < (int)w; x++) {
-                        for (uint32_t c = 0; c < originalChannels && c < forcedChannels; c++) {
-                            rgbaRow[x * forcedChannels + c] = rowBuffer[x * originalChannels + c];
-                        }
-                    }
-                    size_t rowOffsetInTile = (yy - y0) * thisTileW * forcedChannels;
-                    size_t rowOffsetInBuf  = x0 * forcedChannels;
-                    memcpy(&tileData[rowOffsetInTile],
-                           &rgbaRow[rowOffsetInBuf],
-                           thisTileW * forcedChannels);
+                    // Only this tile's span is expanded, straight into its row.
+                    size_t rowOffsetInTile = static_cast<size_t>(yy - y0) * thisTileW * forcedChannels;
+                    PixelConversion::toRGBA8(&rowBuffer[static_cast<size_t>(x0) * originalChannels * sampleBytes], sampleBytes,
+                                             &tileData[rowOffsetInTile], thisTileW, originalChannels);
                 }
                 TextureData data;
                 data.width    = thisTileW;
@@ -157,11 +155,9 @@ TiledResult TextureTiling::tile4(OIIOTexture &texture, uint32_t maxResolution){
                 std::cout << "[TILER] Done with tile " << idx << "\n";
             }
             in->close();
-        }));
-    }
-    for (auto &th : threads) {
-        th.join();
+        });
     }
+    group.wait();
     for (int i = 0; i < totalTiles; i++) {
         if (tileResults[i].width > 0 && tileResults[i].height > 0) {
             result.tiles.push_back(std::move(tileResults[i]));
@@ -172,7 +168,153 @@ TiledResult TextureTiling::tile4(OIIOTexture &texture, uint32_t maxResolution){
 }
 
 
-TiledResult TextureTiling::tile3(OIIOTexture &texture, uint32_t maxResolution){
+TiledResult TextureTiling::tile5(OIIOTexture &texture, uint64_t maxResolution){
+    if (!texture.isInitialized()) {
+        std::cerr << "Cannot tile a texture that is not initialized\n";
+        return {};
+    }
+
+    uint32_t w = texture.getResolution().x;
+    uint32_t h = texture.getResolution().y;
+    uint64_t totalPixels = texture.getResolution().area();
+    if (totalPixels <= maxResolution) {
+        return tile4(texture, maxResolution); // A single tile has nothing to scatter
+    }
+
+    double ratio = (double)totalPixels / (double)maxResolution;
+    double exactN = std::sqrt(ratio);
+    int N = (int)std::ceil(exactN);
+    uint32_t tileW = static_cast<uint32_t>((static_cast<uint64_t>(w) + N - 1) / N);
+    uint32_t tileH = static_cast<uint32_t>((static_cast<uint64_t>(h) + N - 1) / N);
+
+    std::cout << "[Tiler] tileW, tileH: " << tileW << ", " << tileH << std::endl;
+    std::cout << "[Tiler] N: " << N << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    uint32_t forcedChannels = 4;
+
+    std::vector<TextureData> tiles(static_cast<size_t>(N) * N);
+    for (int row = 0; row < N; row++) {
+        for (int col = 0; col < N; col++) {
+            uint32_t x0 = col * tileW;
+            uint32_t y0 = row * tileH;
+            if (x0 >= w || y0 >= h) continue;
+            TextureData& tile = tiles[row * N + col];
+            tile.width    = std::min(x0 + tileW, w) - x0;
+            tile.height   = std::min(y0 + tileH, h) - y0;
+            tile.channels = forcedChannels;
+            tile.pixelData.resize(static_cast<size_t>(tile.width) * tile.height * forcedChannels);
+        }
+    }
+
+    // Each tile column of a band is one pool task, columns never share a destination tile.
+    auto scatterColumn = [&](const ScanlineBand& band, uint32_t col) {
+        size_t pixelBytes = static_cast<size_t>(band.channels) * band.sampleBytes;
+        for (uint32_t y = band.y0; y < band.y1; y++) {
+            const unsigned char* src = band.data + (y - band.y0) * band.rowBytes;
+            uint32_t row = y / tileH;
+            uint32_t rowInTile = y - row * tileH;
+            TextureData& tile = tiles[row * N + col];
+            if (tile.width == 0) continue;
+            PixelConversion::toRGBA8(src + static_cast<size_t>(col) * tileW * pixelBytes, band.sampleBytes,
+                                     tile.pixelData.data() + static_cast<size_t>(rowInTile) * tile.width * forcedChannels,
+                                     tile.width, band.channels);
+        }
+    };
+
+    constexpr uint32_t BAND_ROWS = 64;
+    bool ok = decodeBands(texture.getFilename(), BAND_ROWS, TaskPriority::High, [&](const ScanlineBand& band) {
+        TaskGroup group(TaskPriority::High);
+        for (uint32_t col = 0; col < (uint32_t)N; col++) {
+            group.run([&scatterColumn, &band, col]() { scatterColumn(band, col); });
+        }
+        group.wait();
+        return true;
+    });
+    if (!ok) return {};
+
+    TiledResult result;
+    float stepX = 2.0f / float(N);
+    float stepY = 2.0f / float(N);
+    for (int idx = 0; idx < N * N; idx++) {
+        if (tiles[idx].width == 0 || tiles[idx].height == 0) continue;
+        int row = idx / N;
+        int col = idx % N;
+        float left   = -1.0f + float(col) * stepX;
+        float right  = left + stepX;
+        float top    = 1.0f - float(row) * stepY;
+        float bottom = top - stepY;
+        float index  = float(result.tiles.size());
+
+        Vertex v0 = { { right, -bottom, 0.0f, 0.0f }, { 1.0f, 1.0f, index, 0.0f }, (int) index };
+        Vertex v1 = { { left,  -bottom, 0.0f, 0.0f }, { 0.0f, 1.0f, index, 0.0f }, (int) index };
+        Vertex v2 = { { left,  -top,    0.0f, 0.0f }, { 0.0f, 0.0f, index, 0.0f }, (int) index };
+        Vertex v3 = { { left,  -top,    0.0f, 0.0f }, { 0.0f, 0.0f, index, 0.0f }, (int) index };
+        Vertex v4 = { { right, -top,    0.0f, 0.0f }, { 1.0f, 0.0f, index, 0.0f }, (int) index };
+        Vertex v5 = { { right, -bottom, 0.0f, 0.0f }, { 1.0f, 1.0f, index, 0.0f }, (int) index };
+        result.vertices.insert(result.vertices.end(), {v0, v1, v2, v3, v4, v5});
+        result.tiles.push_back(std::move(tiles[idx]));
+    }
+
+    auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "[Tiler] Band decoded " << result.tiles.size() << " tiles in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << "ms\n";
+    return result;
+}
+
+bool TextureTiling::decodeBands(const std::string& filename, uint32_t bandRows, TaskPriority priority,
+                                const std::function<bool(const ScanlineBand&)>& consume) {
+    std::unique_ptr<OIIO::ImageInput> in = OIIO::ImageInput::open(filename);
+    if (!in) {
+        std::cerr << "Could not open file: " << filename << std::endl;
+        return false;
+    }
+    const OIIO::ImageSpec &spec = in->spec();
+    uint32_t sampleBytes = spec.format == OIIO::TypeDesc::UINT16 ? 2 : 1;
+    OIIO::TypeDesc readFormat = sampleBytes == 2 ? OIIO::TypeDesc::UINT16 : OIIO::TypeDesc::UINT8;
+
+    // Two bands: the decoder fills one while the pool consumes the other.
+    ScanlineBand bands[2];
+    std::vector<unsigned char> storage[2];
+    for (uint32_t slot = 0; slot < 2; slot++) {
+        ScanlineBand& band = bands[slot];
+        band.width       = static_cast<uint32_t>(spec.width);
+        band.height      = static_cast<uint32_t>(spec.height);
+        band.channels    = static_cast<uint32_t>(spec.nchannels);
+        band.sampleBytes = sampleBytes;
+        band.rowBytes    = static_cast<size_t>(band.width) * band.channels * sampleBytes;
+        storage[slot].resize(band.rowBytes * bandRows);
+        band.data        = storage[slot].data();
+    }
+    uint32_t h = bands[0].height;
+
+    auto readBand = [&](uint32_t slot, uint32_t y0) {
+        ScanlineBand& band = bands[slot];
+        band.y0 = y0;
+        band.y1 = std::min(y0 + bandRows, h);
+        if (!in->read_scanlines(0, 0, band.y0, band.y1, 0, 0, band.channels, readFormat, storage[slot].data())) {
+            std::cerr << "Error reading scanlines " << band.y0 << "-" << band.y1 << ": " << in->geterror() << std::endl;
+            return false;
+        }
+        return true;
+    };
+
+    bool ok = readBand(0, 0);
+    bool keepGoing = true;
+    uint32_t current = 0;
+    for (uint32_t y = 0; ok && keepGoing && y < h; y += bandRows) {
+        TaskGroup group(priority);
+        group.run([&consume, &bands, &keepGoing, current]() { keepGoing = consume(bands[current]); });
+        uint32_t next = current ^ 1;
+        if (y + bandRows < h) ok = readBand(next, y + bandRows);
+        group.wait(); // The pool is done with band `current`
+        current = next;
+    }
+    in->close();
+    return ok && keepGoing;
+}
+
+TiledResult TextureTiling::tile3(OIIOTexture &texture, uint64_t maxResolution){
     // n^2 * ~4k < 25*4k: Fit tiles into 100,000x100,000
     static std::vector<int> TILES = {1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121};
 
@@ -185,7 +327,7 @@ TiledResult TextureTiling::tile3(OIIOTexture &texture, uint32_t maxResolution){
 
     uint32_t w = texture.getResolution().x;
     uint32_t h = texture.getResolution().y;
-    uint32_t totalPixels = w * h;
+    uint64_t totalPixels = texture.getResolution().area();
 
     if (totalPixels <= maxResolution) {
         TextureData one;
@@ -221,8 +363,8 @@ TiledResult TextureTiling::tile3(OIIOTexture &texture, uint32_t maxResolution){
     double exactN = std::sqrt(ratio);
     int N = (int)std::ceil(exactN);
 
-    uint32_t tileW = (w + N - 1) / N;
-    uint32_t tileH = (h + N - 1) / N;
+    uint32_t tileW = static_cast<uint32_t>((static_cast<uint64_t>(w) + N - 1) / N);
+    uint32_t tileH = static_cast<uint32_t>((static_cast<uint64_t>(h) + N - 1) / N);
 
     std::cout << "[Tiler] tileW, tileH: " << tileW << ", " << tileH << std::endl;
     std::cout << "[Tiler] Ratio: " << ratio << std::endl;
@@ -238,13 +380,16 @@ TiledResult TextureTiling::tile3(OIIOTexture &texture, uint32_t maxResolution){
 
     uint32_t originalChannels = spec.nchannels;
     uint32_t forcedChannels   = 4;
+    uint32_t sampleBytes      = spec.format == OIIO::TypeDesc::UINT16 ? 2 : 1;
+    OIIO::TypeDesc readFormat = sampleBytes == 2 ? OIIO::TypeDesc::UINT16 : OIIO::TypeDesc::UINT8;
+    size_t rowBytes = static_cast<size_t>(w) * originalChannels * sampleBytes;
 
     float stepX = 2.0f / float(N);
     float stepY = 2.0f / float(N);
 
-    std::vector<unsigned char> fullImage(w * h * originalChannels);
+    std::vector<unsigned char> fullImage(rowBytes * h);
     for (uint32_t y = 0; y < h; y++) {
-        bool ok = in->read_scanline(y, 0, OIIO::TypeDesc::UINT8, fullImage.data() + y * w * originalChannels);
+        bool ok = in->read_scanline(y, 0, readFormat, fullImage.data() + y * rowBytes);
         if (!ok) {
             std::cerr << "Error reading scanline: " << in->geterror() << std::endl;
             in->close();
@@ -257,13 +402,10 @@ TiledResult TextureTiling::tile3(OIIOTexture &texture, uint32_t maxResolution){
     std::vector<TextureData> tileResults(totalTiles);
     std::vector<std::vector<Vertex>> vertexResults(totalTiles);
 
-    int numThreads = 16;
-    int tilesPerThread = (totalTiles + numThreads - 1) / numThreads;
-    std::vector<std::thread> threads;
-    for (int t = 0; t < numThreads; t++) {
-        int start = t * tilesPerThread;
-        int end = std::min(totalTiles, start + tilesPerThread);
-        threads.push_back(std::thread([=, &tileResults, &vertexResults, &fullImage]() {
+    TaskGroup group;
+    for (int start = 0; start < totalTiles; start++) {
+        int end = start + 1;
+        group.run([=, &tileResults, &vertexResults, &fullImage]() {
             for (int idx = start; idx < end; idx++) {
                 int row = idx / N;
                 int col = idx % N;
@@ -276,20 +418,12 @@ TiledResult TextureTiling::tile3(OIIOTexture &texture, uint32_t maxResolution){
                 if (thisTileW <= 0 || thisTileH <= 0) {
                     continue;
                 }
-                std::vector<unsigned char> tileData(thisTileW * thisTileH * forcedChannels, 255);
-                std::vector<unsigned char> rgbaRow(w * forcedChannels, 255);
+                std::vector<unsigned char> tileData(static_cast<size_t>(thisTileW) * thisTileH * forcedChannels, 255);
                 for (int yy = y0; yy < y1; yy++) {
-                    const unsigned char* rowPtr = fullImage.data() + yy * w * originalChannels;
-                    for (int x = 0; x < (int)w; x++) {
-                        for (uint32_t c = 0; c < originalChannels && c < forcedChannels; c++) {
-                            rgbaRow[x * forcedChannels + c] = rowPtr[x * originalChannels + c];
-                        }
-                    }
-                    size_t rowOffsetInTile = (yy - y0) * thisTileW * forcedChannels;
-                    size_t rowOffsetInBuf  = x0 * forcedChannels;
-                    memcpy(&tileData[rowOffsetInTile],
-                           &rgbaRow[rowOffsetInBuf],
-                           thisTileW * forcedChannels);
+                    const unsigned char* rowPtr = fullImage.data() + yy * rowBytes;
+                    size_t rowOffsetInTile = static_cast<size_t>(yy - y0) * thisTileW * forcedChannels;
+                    PixelConversion::toRGBA8(rowPtr + static_cast<size_t>(x0) * originalChannels * sampleBytes, sampleBytes,
+                                             &tileData[rowOffsetInTile], thisTileW, originalChannels);
                 }
 
                 TextureData data;
@@ -328,11 +462,9 @@ TiledResult TextureTiling::tile3(OIIOTexture &texture, uint32_t maxResolution){
 
                 std::cout << "[TILER] Done with tile " << idx << "\n";
             }
-        }));
-    }
-    for (auto &th : threads) {
-        th.join();
+        });
     }
+    group.wait();
 
     for (int i = 0; i < totalTiles; i++) {
         if (tileResults[i].width > 0 && tileResults[i].height > 0) {
@@ -345,7 +477,7 @@ TiledResult TextureTiling::tile3(OIIOTexture &texture, uint32_t maxResolution){
 }
 
 
-TiledResult TextureTiling::tile2(OIIOTexture &texture, uint32_t maxResolution){
+TiledResult TextureTiling::tile2(OIIOTexture &texture, uint64_t maxResolution){
     // n^2 * ~4k < 25*4k: Fit tiles into 100,000x100,000
     static std::vector<int> TILES = {1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121};
 
@@ -358,7 +490,7 @@ TiledResult TextureTiling::tile2(OIIOTexture &texture, uint32_t maxResolution){
 
     uint32_t w = texture.getResolution().x;
     uint32_t h = texture.getResolution().y;
-    uint32_t totalPixels = w * h;
+    uint64_t totalPixels = texture.getResolution().area();
 
     if (totalPixels <= maxResolution) {
         TextureData one;
@@ -393,8 +525,8 @@ TiledResult TextureTiling::tile2(OIIOTexture &texture, uint32_t maxResolution){
     double ratio = (double)totalPixels / (double)maxResolution;
     double exactN = std::sqrt(ratio);
     int N = (int)std::ceil(exactN);
-    uint32_t tileW = (w + N - 1) / N;
-    uint32_t tileH = (h + N - 1) / N;
+    uint32_t tileW = static_cast<uint32_t>((static_cast<uint64_t>(w) + N - 1) / N);
+    uint32_t tileH = static_cast<uint32_t>((static_cast<uint64_t>(h) + N - 1) / N);
 
     std::cout << "[Tiler] tileW, tileH: " << tileW << ", " << tileH << std::endl;
     std::cout << "[Tiler] Ratio: " << ratio << std::endl;
@@ -411,6 +543,8 @@ TiledResult TextureTiling::tile2(OIIOTexture &texture, uint32_t maxResolution){
 
     uint32_t originalChannels = spec.nchannels;
     uint32_t forcedChannels   = 4;
+    uint32_t sampleBytes      = spec.format == OIIO::TypeDesc::UINT16 ? 2 : 1;
+    OIIO::TypeDesc readFormat = sampleBytes == 2 ? OIIO::TypeDesc::UINT16 : OIIO::TypeDesc::UINT8;
 
     float stepX = 2.0f / float(N);
     float stepY = 2.0f / float(N);
@@ -429,27 +563,19 @@ TiledResult TextureTiling::tile2(OIIOTexture &texture, uint32_t maxResolution){
                 continue;
             }
 
-            std::vector<unsigned char> tileData(thisTileW * thisTileH * forcedChannels, 255);
-            std::vector<unsigned char> rowBuffer(w * originalChannels);
-            std::vector<unsigned char> rgbaRow(w * forcedChannels, 255);
+            std::vector<unsigned char> tileData(static_cast<size_t>(thisTileW) * thisTileH * forcedChannels, 255);
+            std::vector<unsigned char> rowBuffer(static_cast<size_t>(w) * originalChannels * sampleBytes);
 
             for (int yy = y0; yy < (int)y1; ++yy) {
-                bool ok = in->read_scanline(yy, 0, OIIO::TypeDesc::UINT8, rowBuffer.data());
+                bool ok = in->read_scanline(yy, 0, readFormat, rowBuffer.data());
                 if (!ok) {
                     std::cerr << "Error reading scanline: " << in->geterror() << std::endl;
                     in->close();
                     return result; 
                 }
-                for (int x = 0; x < (int)w; ++x) {
-                    for (uint32_t c = 0; c < originalChannels && c < forcedChannels; ++c) {
-                        rgbaRow[x * forcedChannels + c] = rowBuffer[x * originalChannels + c];
-                    }
-                }
-                size_t rowOffsetInTile = (yy - y0) * thisTileW * forcedChannels;
-                size_t rowOffsetInBuf  = x0 * forcedChannels;
-                memcpy(&tileData[rowOffsetInTile],
-                        &rgbaRow[rowOffsetInBuf],
-                        thisTileW * forcedChannels);
+                size_t rowOffsetInTile = static_cast<size_t>(yy - y0) * thisTileW * forcedChannels;
+                PixelConversion::toRGBA8(&rowBuffer[static_cast<size_t>(x0) * originalChannels * sampleBytes], sampleBytes,
+                                         &tileData[rowOffsetInTile], thisTileW, originalChannels);
             }
 
             TextureData data;
@@ -499,3 +625,114 @@ TiledResult TextureTiling::tile2(OIIOTexture &texture, uint32_t maxResolution){
     in->close();
     return result;
 }
+
+TextureData TextureTiling::loadRegion(const OIIOTexture &texture, uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) {
+    TextureData data{};
+    if (!texture.isInitialized()) {
+        std::cerr << "Cannot load a region of a texture that is not initialized\n";
+        return data;
+    }
+    if (x1 <= x0 || y1 <= y0) return data;
+
+    // Overview levels of JPEGs come out of the DCT scaled decode, never a full resolution one.
+    std::vector<unsigned char> pixels = texture.loadScaledRegion(level, x0, y0, x1, y1);
+    if (pixels.size() != static_cast<size_t>(x1 - x0) * (y1 - y0) * 4) return data;
+
+    data.width    = x1 - x0;
+    data.height   = y1 - y0;
+    data.channels = 4;
+    data.pixelData = std::move(pixels);
+    return data;
+}
+
+TextureData TextureTiling::loadPreview(const OIIOTexture &texture, uint32_t maxSize) {
+    TextureData data{};
+    if (!texture.isInitialized() || maxSize == 0) {
+        return data;
+    }
+
+    auto filename = texture.getFilename();
+    std::unique_ptr<OIIO::ImageInput> in = OIIO::ImageInput::open(filename);
+    if (!in) {
+        std::cerr << "Could not open file: " << filename << std::endl;
+        return data;
+    }
+    const OIIO::ImageSpec &spec = in->spec();
+    uint32_t w = spec.width;
+    uint32_t h = spec.height;
+    uint32_t forcedChannels = 4;
+
+#if OIIO_VERSION >= OIIO_MAKE_VERSION(2, 4, 0)
+    // Cameras often pad or crop the embedded thumbnail, only trust it when the aspect ratio matches.
+    OIIO::ImageBuf thumbnail;
+    if (in->get_thumbnail(thumbnail, 0) && thumbnail.initialized()) {
+        const OIIO::ImageSpec &thumbSpec = thumbnail.spec();
+        uint32_t tw = thumbSpec.width;
+        uint32_t th = thumbSpec.height;
+        uint32_t channels = thumbSpec.nchannels;
+        double aspect = double(w) / double(std::max(h, 1u));
+        double thumbAspect = double(tw) / double(std::max(th, 1u));
+        if (tw > 0 && th > 0 && tw <= maxSize && th <= maxSize && channels > 0 && std::abs(thumbAspect - aspect) < aspect * 0.02) {
+            std::vector<unsigned char> raw(static_cast<size_t>(tw) * th * channels);
+            if (thumbnail.get_pixels(thumbnail.roi(), OIIO::TypeDesc::UINT8, raw.data())) {
+                data.width    = tw;
+                data.height   = th;
+                data.channels = forcedChannels;
+                data.pixelData.resize(static_cast<size_t>(tw) * th * forcedChannels);
+                PixelConversion::toRGBA8(raw.data(), data.pixelData.data(), static_cast<size_t>(tw) * th, channels);
+                in->close();
+                std::cout << "[Tiler] Preview from embedded " << tw << "x" << th << " thumbnail\n";
+                return data;
+            }
+        }
+    }
+#endif
+
+    // JPEGs decode every scanline anyway, a DCT scaled and box filtered decode is both faster and cleaner.
+    if (std::strcmp(in->format_name(), "jpeg") == 0) {
+        in->close();
+        uint32_t level = 0;
+        while (std::max(w, h) > (static_cast<uint64_t>(maxSize) << level)) level++;
+        Point size{};
+        data.pixelData = texture.loadScaled(level, size);
+        if (data.pixelData.empty()) return {};
+        data.width    = size.x;
+        data.height   = size.y;
+        data.channels = forcedChannels;
+        std::cout << "[Tiler] Scaled " << size.x << "x" << size.y << " JPEG preview, level " << level << "\n";
+        return data;
+    }
+
+    // No usable thumbnail: point sample every step-th pixel of every step-th scanline.
+    uint32_t originalChannels = spec.nchannels;
+    uint32_t sampleBytes      = spec.format == OIIO::TypeDesc::UINT16 ? 2 : 1;
+    OIIO::TypeDesc readFormat = sampleBytes == 2 ? OIIO::TypeDesc::UINT16 : OIIO::TypeDesc::UINT8;
+    uint32_t pixelBytes = originalChannels * sampleBytes;
+    uint32_t step = static_cast<uint32_t>(std::max<uint64_t>(1, (static_cast<uint64_t>(std::max(w, h)) + maxSize - 1) / maxSize));
+    uint32_t outW = static_cast<uint32_t>((static_cast<uint64_t>(w) + step - 1) / step);
+    uint32_t outH = static_cast<uint32_t>((static_cast<uint64_t>(h) + step - 1) / step);
+
+    std::vector<unsigned char> rowBuffer(static_cast<size_t>(w) * pixelBytes);
+    std::vector<unsigned char> sampled(static_cast<size_t>(outW) * pixelBytes);
+    std::vector<unsigned char> pixels(static_cast<size_t>(outW) * outH * forcedChannels);
+    for (uint32_t oy = 0; oy < outH; oy++) {
+        if (!in->read_scanline(oy * step, 0, readFormat, rowBuffer.data())) {
+            std::cerr << "Error reading scanline " << oy * step << ": " << in->geterror() << std::endl;
+            in->close();
+            return {};
+        }
+        // Gathered before conversion so only the kept pixels are expanded.
+        for (uint32_t ox = 0; ox < outW; ox++) {
+            std::memcpy(&sampled[ox * pixelBytes], &rowBuffer[static_cast<size_t>(ox) * step * pixelBytes], pixelBytes);
+        }
+        PixelConversion::toRGBA8(sampled.data(), sampleBytes, &pixels[static_cast<size_t>(oy) * outW * forcedChannels], outW, originalChannels);
+    }
+    in->close();
+
+    data.width    = outW;
+    data.height   = outH;
+    data.channels = forcedChannels;
+    data.pixelData = std::move(pixels);
+    std::cout << "[Tiler] Decimated " << outW << "x" << outH << " preview, step " << step << "\n";
+    return data;
+}
@@ -1,13 +1,24 @@
 #pragma once
+#include <functional>
 #include <texture.h>
 #include <vector>
 #include <Vertex.h>
+#include <ThreadPool.h>
 #include <VulkanRenderer_global.h>
 namespace Veloxr {
 
+    enum class TileFormat : uint32_t {
+        RGBA8 = 0,
+        BC1   = 1,
+        BC7   = 2,
+    };
+
     struct TextureData {
         uint32_t width, height, channels;
         std::vector<unsigned char> pixelData;
+        // Compressed tiles carry their whole mip chain packed level after level.
+        TileFormat format{TileFormat::RGBA8};
+        uint32_t mipLevels{1};
     };
 
     struct TiledResult {
@@ -15,17 +26,42 @@ namespace Veloxr {
         std::vector<Vertex>      vertices;
     };
 
+    // Scanlines [y0, y1) of an image in the file's own channels and sample size.
+    struct ScanlineBand {
+        uint32_t width, height;
+        uint32_t y0, y1;
+        uint32_t channels, sampleBytes;
+        size_t rowBytes;
+        const unsigned char* data;
+    };
+
 
     class VULKANRENDERER_EXPORT TextureTiling {
         
         public:
             TextureTiling() = default;
             void init();
-            std::vector<TextureData> tile(OIIOTexture& texture, uint32_t maxResolution = 4096*2);
+            std::vector<TextureData> tile(OIIOTexture& texture, uint64_t maxResolution = 4096*2);
+
+            TiledResult tile2(OIIOTexture &texture, uint64_t maxResolution=4096*2);
+            TiledResult tile3(OIIOTexture &texture, uint64_t maxResolution=4096*2);
+            TiledResult tile4(OIIOTexture &texture, uint64_t maxResolution=4096*2);
+            // Same grid as tile4, but the file is decoded once top to bottom in bands and every band
+            // is scattered to all tile columns in parallel. Needs about two bands of extra memory.
+            TiledResult tile5(OIIOTexture &texture, uint64_t maxResolution=4096*2);
+
+            // The decoder behind tile5 and the tile cache builder. Reads the file once top to bottom in
+            // bands of bandRows scanlines and hands each to consume as a pool task while the next one is
+            // decoded. consume returns false to stop early. False on read errors or when stopped.
+            static bool decodeBands(const std::string& filename, uint32_t bandRows, TaskPriority priority,
+                                    const std::function<bool(const ScanlineBand&)>& consume);
+
+            // Decode one pixel rect of a pyramid level, level N is N rounds of 2x2 box filtering.
+            TextureData loadRegion(const OIIOTexture &texture, uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
 
-            TiledResult tile2(OIIOTexture &texture, uint32_t maxResolution=4096*2);
-            TiledResult tile3(OIIOTexture &texture, uint32_t maxResolution=4096*2);
-            TiledResult tile4(OIIOTexture &texture, uint32_t maxResolution=4096*2);
+            // Whole image in at most maxSize x maxSize, fast and rough. Uses the embedded thumbnail when
+            // one matches the image, otherwise point samples a decimated grid of scanlines.
+            TextureData loadPreview(const OIIOTexture &texture, uint32_t maxSize);
 
     };
 
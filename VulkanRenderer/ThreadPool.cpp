@@ -0,0 +1,181 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+using namespace Veloxr;
+
+namespace {
+    constexpr uint32_t PRIORITY_COUNT = 3;
+    constexpr uint32_t NOT_A_WORKER = UINT32_MAX;
+
+    std::atomic<uint32_t> defaultThreadCount{0};
+
+    // Which pool and deque the current thread works for, submissions from a worker stay local.
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local uint32_t currentWorker = NOT_A_WORKER;
+}
+
+TaskGroup::TaskGroup(TaskPriority priority, ThreadPool* pool)
+    : _pool(pool ? *pool : ThreadPool::instance()), _priority(priority) {
+}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    _pool.submit(std::move(task), _priority, this);
+}
+
+void TaskGroup::wait() {
+    while (_pending.load(std::memory_order_acquire) > 0) {
+        if (_pool.runOne(this)) continue;
+        // Everything left is running elsewhere, nested tasks may still show up so check back now and then.
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait_for(lock, std::chrono::milliseconds(1), [this]() { return _pending.load(std::memory_order_acquire) == 0; });
+    }
+    // The last task may still be inside _finish(), it holds the lock until it no longer touches the group.
+    std::lock_guard<std::mutex> lock(_mutex);
+}
+
+// Decrements under the lock, together with the lock at the end of wait() the group outlives the notify.
+void TaskGroup::_finish() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        _done.notify_all();
+    }
+}
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t i = 0; i < threadCount; i++) _queues.push_back(std::make_unique<WorkerQueue>());
+    _activeWorkers = threadCount;
+    for (uint32_t i = 0; i < threadCount; i++) _workers.emplace_back(&ThreadPool::_workerLoop, this, i);
+    std::cout << "[POOL] " << threadCount << " worker threads\n";
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    _resume.notify_all();
+    for (auto& worker : _workers) worker.join();
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(defaultThreadCount.load());
+    return pool;
+}
+
+void ThreadPool::setDefaultThreadCount(uint32_t threadCount) {
+    defaultThreadCount = threadCount;
+}
+
+void ThreadPool::setActiveThreadCount(uint32_t count) {
+    uint32_t threadCount = getThreadCount();
+    if (count == 0 || count > threadCount) count = threadCount;
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _activeWorkers.store(count, std::memory_order_release);
+    }
+    _resume.notify_all();
+}
+
+void ThreadPool::submit(std::function<void()> task, TaskPriority priority, TaskGroup* group) {
+    if (group) group->_pending.fetch_add(1, std::memory_order_relaxed);
+
+    // Counted before it is pushed so a thief can never take the count below zero.
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _queued.fetch_add(1, std::memory_order_release);
+    }
+    uint32_t target = currentPool == this ? currentWorker : _nextQueue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+    {
+        std::lock_guard<std::mutex> lock(_queues[target]->mutex);
+        _queues[target]->tasks[static_cast<uint32_t>(priority)].push_back({std::move(task), group});
+    }
+    _wake.notify_one();
+}
+
+bool ThreadPool::runOne(const TaskGroup* group) {
+    Task task;
+    uint32_t self = currentPool == this ? currentWorker : NOT_A_WORKER;
+    if (!_findTask(self, task, group)) return false;
+    _execute(task);
+    return true;
+}
+
+bool ThreadPool::_takeFrom(WorkerQueue& queue, uint32_t priority, bool newest, Task& task, const TaskGroup* group) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    std::deque<Task>& tasks = queue.tasks[priority];
+    if (tasks.empty()) return false;
+
+    auto it = tasks.end();
+    if (!group) {
+        it = newest ? std::prev(tasks.end()) : tasks.begin();
+    } else if (newest) {
+        auto found = std::find_if(tasks.rbegin(), tasks.rend(), [group](const Task& t) { return t.group == group; });
+        if (found != tasks.rend()) it = std::prev(found.base());
+    } else {
+        it = std::find_if(tasks.begin(), tasks.end(), [group](const Task& t) { return t.group == group; });
+    }
+    if (it == tasks.end()) return false;
+
+    task = std::move(*it);
+    tasks.erase(it);
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Highest priority first. Own deque newest first for cache warmth, other deques oldest first.
+bool ThreadPool::_findTask(uint32_t self, Task& task, const TaskGroup* group) {
+    uint32_t count = static_cast<uint32_t>(_queues.size());
+    for (uint32_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+        if (self != NOT_A_WORKER && _takeFrom(*_queues[self], priority, true, task, group)) return true;
+        uint32_t start = self != NOT_A_WORKER ? self + 1 : 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t victim = (start + i) % count;
+            if (victim == self) continue;
+            if (_takeFrom(*_queues[victim], priority, false, task, group)) return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::_execute(Task& task) {
+    try {
+        task.function();
+    } catch (const std::exception& e) {
+        std::cerr << "[POOL] Task threw: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "[POOL] Task threw an unknown exception" << std::endl;
+    }
+    if (task.group) task.group->_finish();
+}
+
+void ThreadPool::_workerLoop(uint32_t index) {
+    currentPool = this;
+    currentWorker = index;
+    while (true) {
+        if (index >= _activeWorkers.load(std::memory_order_acquire)) {
+            std::unique_lock<std::mutex> lock(_sleepMutex);
+            _resume.wait(lock, [this, index]() { return _stop || index < _activeWorkers.load(std::memory_order_acquire); });
+            if (!_stop) continue;
+            // Shutting down, help drain the queues like everyone else
+        }
+
+        Task task;
+        if (_findTask(index, task, nullptr)) {
+            _execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _wake.wait(lock, [this]() { return _stop || _queued.load(std::memory_order_acquire) > 0; });
+        if (_stop && _queued.load(std::memory_order_acquire) == 0) return;
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <VulkanRenderer_global.h>
+
+namespace Veloxr {
+
+    // Workers always take the highest priority task they can find, their own or stolen.
+    enum class TaskPriority : uint32_t {
+        High   = 0, // Tiles the camera is waiting for
+        Normal = 1,
+        Low    = 2, // Background work such as building the tile cache
+    };
+
+    class ThreadPool;
+
+    // Tasks that can be awaited together. wait() runs the group's own queued tasks on the calling
+    // thread, so waiting from inside a pool task does not deadlock. Waits on destruction.
+    class VULKANRENDERER_EXPORT TaskGroup {
+
+        public:
+            explicit TaskGroup(TaskPriority priority = TaskPriority::Normal, ThreadPool* pool = nullptr);
+            ~TaskGroup();
+            TaskGroup(const TaskGroup&) = delete;
+            TaskGroup& operator=(const TaskGroup&) = delete;
+
+            void run(std::function<void()> task);
+            void wait();
+            inline bool isDone() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+        private:
+            friend class ThreadPool;
+            void _finish();
+
+            ThreadPool& _pool;
+            TaskPriority _priority;
+            std::atomic<uint32_t> _pending{0};
+            std::mutex _mutex;
+            std::condition_variable _done;
+    };
+
+    // Process wide work-stealing pool. Every worker owns a deque per priority, pops its own newest
+    // task and steals the oldest from the others when it runs dry.
+    class VULKANRENDERER_EXPORT ThreadPool {
+
+        public:
+            // 0 means one worker per hardware thread.
+            explicit ThreadPool(uint32_t threadCount = 0);
+            ~ThreadPool();
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            static ThreadPool& instance();
+            // Only affects instance() if called before its first use.
+            static void setDefaultThreadCount(uint32_t threadCount);
+
+            void submit(std::function<void()> task, TaskPriority priority = TaskPriority::Normal, TaskGroup* group = nullptr);
+
+            template <typename F>
+            auto async(TaskPriority priority, F&& function) -> std::future<std::invoke_result_t<F>> {
+                using Result = std::invoke_result_t<F>;
+                auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+                std::future<Result> future = task->get_future();
+                submit([task]() { (*task)(); }, priority);
+                return future;
+            }
+
+            // Runs one queued task of group on the calling thread, false if none is queued.
+            bool runOne(const TaskGroup* group);
+
+            inline uint32_t getThreadCount() const { return static_cast<uint32_t>(_workers.size()); }
+            // Parks every worker from index count on, they finish their current task first. Queued tasks
+            // are stolen by the rest. For scaling measurements, 0 or getThreadCount() wakes all of them.
+            void setActiveThreadCount(uint32_t count);
+            inline uint32_t getActiveThreadCount() const { return _activeWorkers.load(std::memory_order_relaxed); }
+
+        private:
+            struct Task {
+                std::function<void()> function;
+                TaskGroup* group;
+            };
+
+            struct WorkerQueue {
+                std::mutex mutex;
+                std::deque<Task> tasks[3]; // Indexed by TaskPriority
+            };
+
+            void _workerLoop(uint32_t index);
+            bool _findTask(uint32_t self, Task& task, const TaskGroup* group);
+            bool _takeFrom(WorkerQueue& queue, uint32_t priority, bool newest, Task& task, const TaskGroup* group);
+            void _execute(Task& task);
+
+            std::vector<std::unique_ptr<WorkerQueue>> _queues;
+            std::vector<std::thread> _workers;
+            std::atomic<uint32_t> _nextQueue{0};
+            std::atomic<uint64_t> _queued{0};
+            std::mutex _sleepMutex;
+            std::condition_variable _wake;
+            std::condition_variable _resume; // Parked workers wait here so they never swallow a _wake notify
+            std::atomic<uint32_t> _activeWorkers{0};
+            bool _stop{false};
+    };
+
+}
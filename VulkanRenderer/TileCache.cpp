@@ -0,0 +1,378 @@
+#include "TileCache.h"
+#include <PixelConversion.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Veloxr;
+
+namespace {
+    constexpr char CACHE_MAGIC[8] = {'V', 'L', 'X', 'R', 'T', 'C', 'H', '\0'};
+    constexpr uint32_t CACHE_VERSION = 2;
+    constexpr uint64_t CACHE_ALIGNMENT = 4096;
+    constexpr uint32_t SCANLINE_CHUNK = 64;
+
+    // FNV-1a, stable across runs and compilers unlike std::hash.
+    uint64_t hashPath(const std::string& path) {
+        uint64_t hash = 1469598103934665603ull;
+        for (unsigned char c : path) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+TileCache::~TileCache() {
+    close();
+}
+
+uint32_t TileCache::_levelWidth(uint32_t level) const {
+    return std::max<uint32_t>(1, static_cast<uint32_t>((static_cast<uint64_t>(_width) + (1ull << level) - 1) >> level));
+}
+
+uint32_t TileCache::_levelHeight(uint32_t level) const {
+    return std::max<uint32_t>(1, static_cast<uint32_t>((static_cast<uint64_t>(_height) + (1ull << level) - 1) >> level));
+}
+
+void TileCache::_computeLayout() {
+    _levelFirstTile.assign(_levels, 0);
+    _levelCols.assign(_levels, 0);
+    _tileOffsets.clear();
+
+    uint64_t tileCount = 0;
+    for (uint32_t level = 0; level < _levels; level++) {
+        _levelFirstTile[level] = tileCount;
+        _levelCols[level] = static_cast<uint32_t>((static_cast<uint64_t>(_levelWidth(level)) + _tileSize - 1) / _tileSize);
+        tileCount += static_cast<uint64_t>(_levelCols[level]) * ((static_cast<uint64_t>(_levelHeight(level)) + _tileSize - 1) / _tileSize);
+    }
+
+    uint64_t offset = sizeof(TileCacheHeader) + tileCount;
+    offset = (offset + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+    _tileOffsets.reserve(tileCount + 1);
+    for (uint32_t level = 0; level < _levels; level++) {
+        uint32_t lw = _levelWidth(level);
+        uint32_t lh = _levelHeight(level);
+        for (uint64_t y0 = 0; y0 < lh; y0 += _tileSize) {
+            for (uint64_t x0 = 0; x0 < lw; x0 += _tileSize) {
+                uint32_t tileW = static_cast<uint32_t>(std::min<uint64_t>(_tileSize, lw - x0));
+                uint32_t tileH = static_cast<uint32_t>(std::min<uint64_t>(_tileSize, lh - y0));
+                _tileOffsets.push_back(offset);
+                offset += _format == TileFormat::RGBA8 ? static_cast<uint64_t>(tileW) * tileH * 4
+                                                       : BlockCompression::chainSize(_format, tileW, tileH);
+            }
+        }
+    }
+    _tileOffsets.push_back(offset);
+    _fileSize = offset;
+}
+
+uint64_t TileCache::_tileIndex(const TileKey& key) const {
+    return _levelFirstTile[key.level] + static_cast<uint64_t>(key.row) * _levelCols[key.level] + key.col;
+}
+
+bool TileCache::open(const std::string& sourcePath, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t levels,
+                     const std::string& cacheDirectory, TileFormat format) {
+    close();
+
+    std::error_code ec;
+    uint64_t sourceSize = std::filesystem::file_size(sourcePath, ec);
+    if (ec) {
+        std::cerr << "[CACHE] Cannot stat " << sourcePath << ": " << ec.message() << std::endl;
+        return false;
+    }
+    int64_t sourceModified = static_cast<int64_t>(std::filesystem::last_write_time(sourcePath, ec).time_since_epoch().count());
+    uint64_t pathHash = hashPath(sourcePath);
+
+    const char* suffix = format == TileFormat::BC1 ? ".bc1.vxtc" : format == TileFormat::BC7 ? ".bc7.vxtc" : ".vxtc";
+    if (cacheDirectory.empty()) {
+        _path = sourcePath + suffix;
+    } else {
+        std::filesystem::create_directories(cacheDirectory, ec);
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(pathHash), suffix);
+        _path = (std::filesystem::path(cacheDirectory) / name).string();
+    }
+
+    _width = width;
+    _height = height;
+    _tileSize = tileSize;
+    _levels = levels;
+    _format = format;
+    _computeLayout();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (_map(_fileSize, false)) {
+        const TileCacheHeader* header = _header();
+        bool valid = std::memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+            header->version == CACHE_VERSION && header->tileSize == tileSize &&
+            header->width == width && header->height == height && header->levels == levels &&
+            header->format == static_cast<uint32_t>(format) && header->sourceSize == sourceSize && header->sourceModified == sourceModified &&
+            header->pathHash == pathHash && header->fileSize == _fileSize;
+        if (valid) {
+            auto elapsed = std::chrono::high_resolution_clock::now() - start;
+            std::cout << "[CACHE] Mapped " << _path << (header->complete ? "" : " (partial)") << " in "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " microseconds\n";
+            return true;
+        }
+        std::cout << "[CACHE] " << _path << " is stale, rebuilding\n";
+        _unmap();
+    }
+
+    if (!_map(_fileSize, true)) {
+        std::cerr << "[CACHE] Could not create " << _path << ", tiles will be decoded from the source\n";
+        _path.clear();
+        return false;
+    }
+
+    uint64_t tileCount = _tileOffsets.size() - 1;
+    TileCacheHeader* header = _header();
+    std::memset(header, 0, sizeof(TileCacheHeader));
+    std::memset(_readyFlags(), 0, tileCount);
+    std::memcpy(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header->version = CACHE_VERSION;
+    header->tileSize = tileSize;
+    header->width = width;
+    header->height = height;
+    header->levels = levels;
+    header->complete = 0;
+    header->format = static_cast<uint32_t>(format);
+    header->sourceSize = sourceSize;
+    header->sourceModified = sourceModified;
+    header->pathHash = pathHash;
+    header->tileCount = tileCount;
+    header->dataOffset = _tileOffsets.front();
+    header->fileSize = _fileSize;
+    std::cout << "[CACHE] Created " << _path << ", " << (_fileSize / 1024.0 / 1024.0) << " MB\n";
+    return true;
+}
+
+#ifdef _WIN32
+
+bool TileCache::_map(uint64_t size, bool create) {
+    HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER existing{};
+    if (!create && (!GetFileSizeEx(file, &existing) || static_cast<uint64_t>(existing.QuadPart) != size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    _fileHandle = file;
+    _mappingHandle = mapping;
+    _mapping = static_cast<uint8_t*>(view);
+    return true;
+}
+
+void TileCache::_unmap() {
+    if (_mapping) UnmapViewOfFile(_mapping);
+    if (_mappingHandle) CloseHandle(static_cast<HANDLE>(_mappingHandle));
+    if (_fileHandle) CloseHandle(static_cast<HANDLE>(_fileHandle));
+    _mapping = nullptr;
+    _mappingHandle = nullptr;
+    _fileHandle = nullptr;
+}
+
+void TileCache::_flush() {
+    if (!_mapping) return;
+    FlushViewOfFile(_mapping, 0);
+    FlushFileBuffers(static_cast<HANDLE>(_fileHandle));
+}
+
+#else
+
+bool TileCache::_map(uint64_t size, bool create) {
+    int fd = ::open(_path.c_str(), create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0644);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (!create && (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) != size)) {
+        ::close(fd);
+        return false;
+    }
+    // Sparse on most filesystems, pages only hit the disk once the builder writes them.
+    if (create && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    _fd = fd;
+    _mapping = static_cast<uint8_t*>(view);
+    return true;
+}
+
+void TileCache::_unmap() {
+    if (_mapping) munmap(_mapping, _fileSize);
+    if (_fd >= 0) ::close(_fd);
+    _mapping = nullptr;
+    _fd = -1;
+}
+
+void TileCache::_flush() {
+    if (_mapping) msync(_mapping, _fileSize, MS_SYNC);
+}
+
+#endif
+
+void TileCache::close() {
+    _cancel = true;
+    _builder.wait();
+    _cancel = false;
+    _accumulators.clear();
+    _unmap();
+}
+
+bool TileCache::hasTile(const TileKey& key) const {
+    if (!isOpen() || key.level >= _levels) return false;
+    uint64_t index = _tileIndex(key);
+    if (index + 1 >= _tileOffsets.size()) return false;
+    return std::atomic_ref<uint8_t>(_readyFlags()[index]).load(std::memory_order_acquire) != 0;
+}
+
+TextureData TileCache::readTile(const TileKey& key) const {
+    TextureData data{};
+    if (!hasTile(key)) return data;
+
+    uint32_t lw = _levelWidth(key.level);
+    uint32_t lh = _levelHeight(key.level);
+    uint64_t index = _tileIndex(key);
+    data.width = static_cast<uint32_t>(std::min<uint64_t>(_tileSize, lw - static_cast<uint64_t>(key.col) * _tileSize));
+    data.height = static_cast<uint32_t>(std::min<uint64_t>(_tileSize, lh - static_cast<uint64_t>(key.row) * _tileSize));
+    data.channels = 4;
+    data.format = _format;
+    data.mipLevels = _format == TileFormat::RGBA8 ? 1 : BlockCompression::fullMipChain(data.width, data.height);
+
+    const uint8_t* pixels = _mapping + _tileOffsets[index];
+    data.pixelData.assign(pixels, pixels + (_tileOffsets[index + 1] - _tileOffsets[index]));
+    return data;
+}
+
+bool TileCache::writeTile(const TileKey& key, const TextureData& data) {
+    if (!isOpen() || key.level >= _levels || data.format != _format) return false;
+    uint64_t index = _tileIndex(key);
+    if (index + 1 >= _tileOffsets.size()) return false;
+    uint64_t size = _tileOffsets[index + 1] - _tileOffsets[index];
+    if (data.pixelData.size() != size) return false;
+
+    // Pixels land before the flag, readers only look at tiles whose flag they acquired.
+    std::memcpy(_mapping + _tileOffsets[index], data.pixelData.data(), size);
+    std::atomic_ref<uint8_t>(_readyFlags()[index]).store(1, std::memory_order_release);
+    return true;
+}
+
+void TileCache::buildAsync(const OIIOTexture& source) {
+    if (!isOpen() || isComplete() || !_builder.isDone() || _format != TileFormat::RGBA8) return;
+    _builder.run([this, source]() { _build(source); });
+}
+
+// Writes one row of a level straight into the mapped tiles it crosses, then folds it into the next level.
+void TileCache::_emitRow(uint32_t level, uint32_t y, const unsigned char* row) {
+    uint32_t lw = _levelWidth(level);
+    uint32_t lh = _levelHeight(level);
+    uint32_t tileRow = y / _tileSize;
+    uint32_t tileH = static_cast<uint32_t>(std::min<uint64_t>(_tileSize, lh - static_cast<uint64_t>(tileRow) * _tileSize));
+    uint32_t rowInTile = y - tileRow * _tileSize;
+
+    for (uint32_t col = 0; col < _levelCols[level]; col++) {
+        uint64_t x0 = static_cast<uint64_t>(col) * _tileSize;
+        uint32_t tileW = static_cast<uint32_t>(std::min<uint64_t>(_tileSize, lw - x0));
+        uint64_t index = _levelFirstTile[level] + static_cast<uint64_t>(tileRow) * _levelCols[level] + col;
+        std::memcpy(_mapping + _tileOffsets[index] + static_cast<uint64_t>(rowInTile) * tileW * 4, row + x0 * 4, tileW * 4);
+        if (rowInTile + 1 == tileH) {
+            std::atomic_ref<uint8_t>(_readyFlags()[index]).store(1, std::memory_order_release);
+        }
+    }
+
+    if (level + 1 >= _levels) return;
+
+    // 2x2 box filter, partial blocks on odd edges average what they have.
+    LevelAccumulator& acc = _accumulators[level + 1];
+    uint32_t nw = _levelWidth(level + 1);
+    for (size_t x = 0; x < nw; x++) {
+        size_t sx = x * 2;
+        for (uint32_t c = 0; c < 4; c++) {
+            uint16_t value = row[sx * 4 + c];
+            if (sx + 1 < lw) value += row[(sx + 1) * 4 + c];
+            acc.sum[x * 4 + c] += value;
+        }
+    }
+    acc.rows++;
+
+    if (acc.rows == 2 || y + 1 == lh) {
+        std::vector<unsigned char> out(static_cast<size_t>(nw) * 4);
+        for (size_t x = 0; x < nw; x++) {
+            uint32_t n = acc.rows * ((x * 2 + 1 < lw) ? 2 : 1);
+            for (uint32_t c = 0; c < 4; c++) {
+                out[x * 4 + c] = static_cast<unsigned char>((acc.sum[x * 4 + c] + n / 2) / n);
+            }
+        }
+        std::fill(acc.sum.begin(), acc.sum.end(), 0);
+        acc.rows = 0;
+        _emitRow(level + 1, y / 2, out.data());
+    }
+}
+
+void TileCache::_build(OIIOTexture source) {
+    auto start = std::chrono::high_resolution_clock::now();
+    _accumulators.assign(_levels, {});
+    for (uint32_t level = 1; level < _levels; level++) {
+        _accumulators[level].sum.assign(static_cast<size_t>(_levelWidth(level)) * 4, 0);
+    }
+
+    // Bands are consumed one at a time in order, the pyramid rows depend on the ones above them.
+    std::vector<unsigned char> rgba(static_cast<size_t>(_width) * 4);
+    bool decoded = TextureTiling::decodeBands(source.getFilename(), SCANLINE_CHUNK, TaskPriority::Low, [&](const ScanlineBand& band) {
+        if (band.width != _width || band.height != _height) {
+            std::cerr << "[CACHE] Source size changed while building, giving up\n";
+            return false;
+        }
+        for (uint32_t y = band.y0; y < band.y1 && !_cancel; y++) {
+            PixelConversion::toRGBA8(band.data + (y - band.y0) * band.rowBytes, band.sampleBytes, rgba.data(), _width, band.channels);
+            _emitRow(0, y, rgba.data());
+        }
+        return !_cancel;
+    });
+    if (!decoded || _cancel) return;
+
+    _flush();
+    _header()->complete = 1;
+    _flush();
+
+    auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "[CACHE] Built " << _path << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << "ms\n";
+}
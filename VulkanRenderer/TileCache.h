@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <texture.h>
+#include <BlockCompression.h>
+#include <TextureTiling.h>
+#include <ThreadPool.h>
+#include <TileResidency.h>
+#include <VulkanRenderer_global.h>
+
+namespace Veloxr {
+
+    // On-disk layout, everything little endian:
+    //   TileCacheHeader
+    //   uint8_t ready[tileCount]        one flag per tile, set once its pixels are written
+    //   tiles, level by level, row major, padded to 4096 bytes before the first one
+    // Tiles use the same pyramid as TileResidency so a TileKey maps straight to an offset.
+    // RGBA8 caches store bare pixels and are filled by the builder. Block compressed caches store
+    // each tile's full packed mip chain and are written back tile by tile as the loaders encode them.
+    struct TileCacheHeader {
+        char     magic[8];
+        uint32_t version;
+        uint32_t tileSize;
+        uint32_t width, height;
+        uint32_t levels;
+        uint32_t complete;
+        uint32_t format;
+        uint32_t reserved;
+        uint64_t sourceSize;
+        int64_t  sourceModified;
+        uint64_t pathHash;
+        uint64_t tileCount;
+        uint64_t dataOffset;
+        uint64_t fileSize;
+    };
+
+    class VULKANRENDERER_EXPORT TileCache {
+
+        public:
+            TileCache() = default;
+            ~TileCache();
+            TileCache(const TileCache&) = delete;
+            TileCache& operator=(const TileCache&) = delete;
+
+            // Maps the cache for sourcePath, creating it when missing or stale. An empty cacheDirectory puts it next to the source.
+            bool open(const std::string& sourcePath, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t levels,
+                      const std::string& cacheDirectory = "", TileFormat format = TileFormat::RGBA8);
+
+            // Decodes the source once, top to bottom, and fills every level as a low priority pool task.
+            // No-op once complete and for compressed caches.
+            void buildAsync(const OIIOTexture& source);
+            void close();
+
+            bool hasTile(const TileKey& key) const;
+            TextureData readTile(const TileKey& key) const;
+            // Stores a tile that matches the cache format, safe to call from several threads for different keys.
+            bool writeTile(const TileKey& key, const TextureData& data);
+
+            inline bool isOpen() const { return _mapping != nullptr; }
+            inline bool isComplete() const { return isOpen() && _header()->complete != 0; }
+            inline const std::string& getPath() const { return _path; }
+            inline TileFormat getFormat() const { return _format; }
+
+        private:
+            TileCacheHeader* _header() const { return reinterpret_cast<TileCacheHeader*>(_mapping); }
+            uint8_t* _readyFlags() const { return _mapping + sizeof(TileCacheHeader); }
+
+            uint64_t _tileIndex(const TileKey& key) const;
+            uint32_t _levelWidth(uint32_t level) const;
+            uint32_t _levelHeight(uint32_t level) const;
+            void _computeLayout();
+            bool _map(uint64_t size, bool create);
+            void _unmap();
+            void _flush();
+
+            void _build(OIIOTexture source);
+            void _emitRow(uint32_t level, uint32_t y, const unsigned char* row);
+
+            std::string _path;
+            uint32_t _width{0}, _height{0};
+            uint32_t _tileSize{0};
+            uint32_t _levels{0};
+            TileFormat _format{TileFormat::RGBA8};
+
+            std::vector<uint64_t> _levelFirstTile;
+            std::vector<uint32_t> _levelCols;
+            std::vector<uint64_t> _tileOffsets;
+            uint64_t _fileSize{0};
+
+            uint8_t* _mapping{nullptr};
+#ifdef _WIN32
+            void* _fileHandle{nullptr};
+            void* _mappingHandle{nullptr};
+#else
+            int _fd{-1};
+#endif
+
+            // Builder state, one pending half-height row per level for the 2x2 box filter.
+            struct LevelAccumulator {
+                std::vector<uint16_t> sum;
+                uint32_t rows{0};
+            };
+            std::vector<LevelAccumulator> _accumulators;
+            TaskGroup _builder{TaskPriority::Low};
+            std::atomic<bool> _cancel{false};
+    };
+
+}
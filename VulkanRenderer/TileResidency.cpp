@@ -0,0 +1,239 @@
+#include "TileResidency.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace Veloxr;
+
+void TileResidency::init(uint32_t width, uint32_t height, uint32_t tileSize, uint64_t budgetBytes, uint32_t maxTiles, uint32_t maxLoadsInFlight) {
+    _width = width;
+    _height = height;
+    _tileSize = std::max<uint32_t>(tileSize, 1);
+    _budget = budgetBytes;
+    _maxTiles = maxTiles;
+    _maxLoadsInFlight = std::max<uint32_t>(maxLoadsInFlight, 1);
+    _loadsInFlight = 0;
+    _tileCount = 0;
+    _residentBytes = 0;
+    _currentLevel = 0;
+    _frame = 0;
+    _entries.clear();
+    _settled = false;
+
+    // Keep halving until a single tile covers the whole level, that tile is our always-resident fallback.
+    _levels = 1;
+    while (_levelWidth(_levels - 1) > _tileSize || _levelHeight(_levels - 1) > _tileSize) {
+        _levels++;
+    }
+
+    std::cout << "[RESIDENCY] " << _width << "x" << _height << " tileSize " << _tileSize
+              << ", levels " << _levels << ", budget " << (_budget / 1024.0 / 1024.0) << " MB\n";
+}
+
+uint32_t TileResidency::_levelWidth(uint32_t level) const {
+    return std::max<uint32_t>(1, static_cast<uint32_t>((static_cast<uint64_t>(_width) + (1ull << level) - 1) >> level));
+}
+
+uint32_t TileResidency::_levelHeight(uint32_t level) const {
+    return std::max<uint32_t>(1, static_cast<uint32_t>((static_cast<uint64_t>(_height) + (1ull << level) - 1) >> level));
+}
+
+TileRegion TileResidency::region(const TileKey& key) const {
+    TileRegion r{};
+    r.levelWidth  = _levelWidth(key.level);
+    r.levelHeight = _levelHeight(key.level);
+    r.x0 = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(key.col) * _tileSize, r.levelWidth));
+    r.y0 = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(key.row) * _tileSize, r.levelHeight));
+    r.x1 = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(r.x0) + _tileSize, r.levelWidth));
+    r.y1 = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(r.y0) + _tileSize, r.levelHeight));
+
+    // Divided in double, a float cannot hold pixel coordinates of gigapixel levels exactly.
+    r.left   = float(-1.0 + 2.0 * double(r.x0) / double(r.levelWidth));
+    r.right  = float(-1.0 + 2.0 * double(r.x1) / double(r.levelWidth));
+    r.top    = float(-1.0 + 2.0 * double(r.y0) / double(r.levelHeight));
+    r.bottom = float(-1.0 + 2.0 * double(r.y1) / double(r.levelHeight));
+    return r;
+}
+
+uint64_t TileResidency::tileBytes(const TileKey& key) const {
+    TileRegion r = region(key);
+    // Every tile carries its mip chain, a third on top of level 0, the same estimate the tile array is sized with.
+    return static_cast<uint64_t>(r.x1 - r.x0) * static_cast<uint64_t>(r.y1 - r.y0) * _bitsPerTexel / 8 * 4 / 3;
+}
+
+bool TileResidency::_evictOne(const TileKey& keep, Update& update) {
+    TileKey fallback = getFallbackTile();
+    auto victim = _entries.end();
+    for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+        const Entry& e = it->second;
+        if (e.state != State::Resident || e.lastUsed >= _frame) continue;
+        if (it->first == fallback || it->first == keep) continue;
+        if (victim == _entries.end() || e.lastUsed < victim->second.lastUsed) {
+            victim = it;
+        }
+    }
+    if (victim == _entries.end()) return false;
+
+    _residentBytes -= victim->second.bytes;
+    _tileCount--;
+    update.toEvict.push_back(victim->first);
+    _entries.erase(victim);
+    return true;
+}
+
+TileResidency::Update TileResidency::update(const glm::mat4& viewProjection, uint32_t viewportWidth, uint32_t viewportHeight) {
+    Update result;
+    if (!isInitialized()) return result;
+    _frame++;
+
+    // Unproject the NDC corners to find the world rect on screen.
+    glm::mat4 inverse = glm::inverse(viewProjection);
+    glm::vec4 a = inverse * glm::vec4(-1.0f, -1.0f, 0.0f, 1.0f);
+    glm::vec4 b = inverse * glm::vec4( 1.0f,  1.0f, 0.0f, 1.0f);
+    float minX = std::min(a.x, b.x), maxX = std::max(a.x, b.x);
+    float minY = std::min(a.y, b.y), maxY = std::max(a.y, b.y);
+
+    // Texels of level 0 per screen pixel picks the level, finer axis wins.
+    double texelsX = (double(maxX - minX) * 0.5 * _width) / std::max<uint32_t>(viewportWidth, 1);
+    double texelsY = (double(maxY - minY) * 0.5 * _height) / std::max<uint32_t>(viewportHeight, 1);
+    double density = std::min(texelsX, texelsY);
+    uint32_t level = density > 1.0 ? static_cast<uint32_t>(std::floor(std::log2(density))) : 0;
+    _currentLevel = std::min(level, _levels - 1);
+
+    // Visible rect as [0, 1] fractions of the image
+    float fx0 = std::clamp((minX + 1.0f) * 0.5f, 0.0f, 1.0f);
+    float fx1 = std::clamp((maxX + 1.0f) * 0.5f, 0.0f, 1.0f);
+    float fy0 = std::clamp((minY + 1.0f) * 0.5f, 0.0f, 1.0f);
+    float fy1 = std::clamp((maxY + 1.0f) * 0.5f, 0.0f, 1.0f);
+
+    std::vector<TileKey> wanted;
+    wanted.push_back(getFallbackTile());
+
+    if (fx1 > fx0 && fy1 > fy0 && _currentLevel != _levels - 1) {
+        uint32_t lw = _levelWidth(_currentLevel);
+        uint32_t lh = _levelHeight(_currentLevel);
+        uint32_t cols = static_cast<uint32_t>((static_cast<uint64_t>(lw) + _tileSize - 1) / _tileSize);
+        uint32_t rows = static_cast<uint32_t>((static_cast<uint64_t>(lh) + _tileSize - 1) / _tileSize);
+        auto tileOf = [&](double pixel, uint32_t count) {
+            return static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(pixel) / _tileSize, count - 1));
+        };
+        uint32_t c0 = tileOf(double(fx0) * lw, cols);
+        uint32_t c1 = tileOf(std::ceil(double(fx1) * lw), cols);
+        uint32_t r0 = tileOf(double(fy0) * lh, rows);
+        uint32_t r1 = tileOf(std::ceil(double(fy1) * lh), rows);
+
+        std::vector<TileKey> visible;
+        for (uint32_t row = r0; row <= r1; row++) {
+            for (uint32_t col = c0; col <= c1; col++) {
+                visible.push_back({_currentLevel, col, row});
+            }
+        }
+
+        // Closest to the view centre loads first
+        float cx = (minX + maxX) * 0.5f;
+        float cy = (minY + maxY) * 0.5f;
+        auto distance = [&](const TileKey& key) {
+            TileRegion r = region(key);
+            float dx = (r.left + r.right) * 0.5f - cx;
+            float dy = (r.top + r.bottom) * 0.5f - cy;
+            return dx * dx + dy * dy;
+        };
+        std::sort(visible.begin(), visible.end(), [&](const TileKey& l, const TileKey& r) {
+            return distance(l) < distance(r);
+        });
+        wanted.insert(wanted.end(), visible.begin(), visible.end());
+    }
+
+    bool deferred = false;
+    for (const TileKey& key : wanted) {
+        auto it = _entries.find(key);
+        uint32_t failures = 0;
+        if (it != _entries.end()) {
+            it->second.lastUsed = _frame;
+            if (it->second.state != State::Failed || it->second.retryFrame > _frame) continue;
+            failures = it->second.failures;
+        }
+        if (_loadsInFlight >= _maxLoadsInFlight) {
+            deferred = true;
+            continue;
+        }
+
+        uint64_t bytes = tileBytes(key);
+        bool fits = true;
+        while (_residentBytes + bytes > _budget || _tileCount + 1 > _maxTiles) {
+            if (!_evictOne(key, result)) {
+                fits = false;
+                break;
+            }
+        }
+        // The fallback tile always goes in, it is what we draw while everything else streams.
+        if (!fits && !(key == getFallbackTile())) continue;
+
+        _entries[key] = {State::Loading, bytes, _frame, failures};
+        _residentBytes += bytes;
+        _tileCount++;
+        _loadsInFlight++;
+        result.toLoad.push_back(key);
+    }
+
+    // Failed tiles hold no memory, once their backoff is over the ones nobody wanted this update are forgotten.
+    std::erase_if(_entries, [this](const auto& item) {
+        const Entry& e = item.second;
+        return e.state == State::Failed && e.retryFrame <= _frame && e.lastUsed < _frame;
+    });
+
+    _settled = !deferred && _loadsInFlight == 0;
+    return result;
+}
+
+void TileResidency::markLoaded(const TileKey& key) {
+    auto it = _entries.find(key);
+    if (it == _entries.end() || it->second.state != State::Loading) return;
+    it->second.state = State::Resident;
+    _loadsInFlight--;
+}
+
+void TileResidency::markFailed(const TileKey& key) {
+    auto it = _entries.find(key);
+    if (it == _entries.end() || it->second.state != State::Loading) return;
+    // Keep the entry around so we do not retry every frame, it holds no memory.
+    Entry& e = it->second;
+    e.failures++;
+    uint64_t backoff = RETRY_UPDATES << std::min(e.failures - 1, MAX_RETRY_DOUBLINGS);
+    e.retryFrame = _frame + backoff;
+    std::cerr << "[RESIDENCY] Failed to load tile " << key.level << "/" << key.col << "/" << key.row
+              << ", retrying in " << backoff << " updates\n";
+    _residentBytes -= e.bytes;
+    e.bytes = 0;
+    e.state = State::Failed;
+    _tileCount--;
+    _loadsInFlight--;
+}
+
+bool TileResidency::adoptResident(const TileKey& key) {
+    if (!isInitialized() || key.level >= _levels || _entries.count(key)) return false;
+    uint64_t bytes = tileBytes(key);
+    if (_residentBytes + bytes > _budget || _tileCount + 1 > _maxTiles) return false;
+    _entries[key] = {State::Resident, bytes, _frame};
+    _residentBytes += bytes;
+    _tileCount++;
+    return true;
+}
+
+uint64_t TileResidency::getLastUsed(const TileKey& key) const {
+    auto it = _entries.find(key);
+    return it == _entries.end() ? 0 : it->second.lastUsed;
+}
+
+std::vector<TileKey> TileResidency::drawList() const {
+    std::vector<TileKey> result;
+    for (const auto& [key, entry] : _entries) {
+        if (entry.state == State::Resident) result.push_back(key);
+    }
+    std::sort(result.begin(), result.end(), [](const TileKey& l, const TileKey& r) {
+        if (l.level != r.level) return l.level > r.level;
+        if (l.row != r.row) return l.row < r.row;
+        return l.col < r.col;
+    });
+    return result;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <VulkanRenderer_global.h>
+
+namespace Veloxr {
+
+    // Level 0 is full resolution, every level above halves both dimensions.
+    struct TileKey {
+        uint32_t level, col, row;
+
+        bool operator==(const TileKey& other) const {
+            return level == other.level && col == other.col && row == other.row;
+        }
+    };
+
+    struct TileKeyHash {
+        size_t operator()(const TileKey& key) const {
+            return (static_cast<size_t>(key.level) << 48) ^ (static_cast<size_t>(key.row) << 24) ^ key.col;
+        }
+    };
+
+    struct TileRegion {
+        // Pixel rect inside the tile's pyramid level
+        uint32_t x0, y0, x1, y1;
+        uint32_t levelWidth, levelHeight;
+        // World rect, the whole image spans [-1, 1] on both axes
+        float left, right, top, bottom;
+    };
+
+    class VULKANRENDERER_EXPORT TileResidency {
+
+        public:
+            struct Update {
+                std::vector<TileKey> toLoad;  // Highest priority first
+                std::vector<TileKey> toEvict;
+            };
+
+            TileResidency() = default;
+            void init(uint32_t width, uint32_t height, uint32_t tileSize, uint64_t budgetBytes, uint32_t maxTiles, uint32_t maxLoadsInFlight = 4);
+
+            // Call once per frame with the camera's view projection and the viewport size in pixels.
+            Update update(const glm::mat4& viewProjection, uint32_t viewportWidth, uint32_t viewportHeight);
+
+            void markLoaded(const TileKey& key);
+            // Retried with a backoff for as long as update() still wants the tile.
+            void markFailed(const TileKey& key);
+            // A tile still resident from an earlier visit to this image, counted as loaded without a load.
+            // False if it does not fit the budget or tile limit, the caller releases it then.
+            bool adoptResident(const TileKey& key);
+            // Frame of the last update() that wanted the tile, 0 if it is unknown.
+            uint64_t getLastUsed(const TileKey& key) const;
+
+            // Resident tiles, coarsest level first so finer tiles draw on top.
+            std::vector<TileKey> drawList() const;
+
+            TileRegion region(const TileKey& key) const;
+            // Device memory of the tile including its mip chain, what the budget is charged.
+            uint64_t tileBytes(const TileKey& key) const;
+            // 32 for RGBA8, 4 for BC1, 8 for BC7. Only affects budgeting of tiles loaded afterwards.
+            inline void setBitsPerTexel(uint32_t bits) { _bitsPerTexel = bits; }
+
+            inline bool isInitialized() const { return _levels > 0; }
+            inline uint32_t getLevelCount() const { return _levels; }
+            inline uint32_t getCurrentLevel() const { return _currentLevel; }
+            inline uint32_t getTileSize() const { return _tileSize; }
+            inline uint64_t getResidentBytes() const { return _residentBytes; }
+            inline uint64_t getBudget() const { return _budget; }
+            inline TileKey getFallbackTile() const { return {_levels - 1, 0, 0}; }
+            // The last update() wanted nothing that is still loading or waiting for a load slot,
+            // everything it could fit in the budget is resident.
+            inline bool isSettled() const { return _settled; }
+
+        private:
+            enum class State { Loading, Resident, Failed };
+
+            // A failed tile is retried after this many updates, doubling with every further failure.
+            static constexpr uint64_t RETRY_UPDATES = 30;
+            static constexpr uint32_t MAX_RETRY_DOUBLINGS = 6;
+
+            struct Entry {
+                State state;
+                uint64_t bytes;
+                uint64_t lastUsed;
+                uint32_t failures{0};
+                uint64_t retryFrame{0}; // Failed only, first update that may load it again
+            };
+
+            uint32_t _levelWidth(uint32_t level) const;
+            uint32_t _levelHeight(uint32_t level) const;
+            bool _evictOne(const TileKey& keep, Update& update);
+
+            uint32_t _width{0}, _height{0};
+            uint32_t _tileSize{0};
+            uint32_t _levels{0};
+            uint32_t _currentLevel{0};
+            uint32_t _maxTiles{0};
+            uint32_t _maxLoadsInFlight{0};
+            uint32_t _loadsInFlight{0};
+            uint32_t _tileCount{0};
+            uint32_t _bitsPerTexel{32};
+            uint64_t _budget{0};
+            uint64_t _residentBytes{0};
+            uint64_t _frame{0};
+            bool _settled{true};
+            std::unordered_map<TileKey, Entry, TileKeyHash> _entries;
+    };
+
+}
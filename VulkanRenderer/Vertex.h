@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 #include <array>
+#include <cstdint>
 namespace Veloxr {
 
 
@@ -30,7 +31,7 @@ namespace Veloxr {
 
             attributeDescriptions[1].binding = 0;
             attributeDescriptions[1].location = 1;
-            attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+            attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
             attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
 
             attributeDescriptions[2].binding = 0;
@@ -42,4 +43,56 @@ namespace Veloxr {
         }
     };
 
+    // Corner of the unit quad every tile instance is drawn from, (0, 0) is top left.
+    struct QuadVertex {
+        glm::vec2 corner;
+    };
+
+    // One per drawn tile, the vertex shader places the unit quad from it.
+    struct TileInstance {
+        glm::vec4 rect;   // left, top, right, bottom in world space
+        glm::vec4 uvRect; // u0, v0, u1, v1 of the tile's texels in its slot
+        int slot;
+
+        // Binding 0 steps per vertex through the unit quad, binding 1 per instance through the tiles.
+        static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions() {
+            std::array<VkVertexInputBindingDescription, 2> bindingDescriptions{};
+            bindingDescriptions[0].binding = 0;
+            bindingDescriptions[0].stride = sizeof(QuadVertex);
+            bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+            bindingDescriptions[1].binding = 1;
+            bindingDescriptions[1].stride = sizeof(TileInstance);
+            bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+            return bindingDescriptions;
+        }
+        static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions() {
+            std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+
+            attributeDescriptions[0].binding = 0;
+            attributeDescriptions[0].location = 0;
+            attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+            attributeDescriptions[0].offset = offsetof(QuadVertex, corner);
+
+            attributeDescriptions[1].binding = 1;
+            attributeDescriptions[1].location = 1;
+            attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[1].offset = offsetof(TileInstance, rect);
+
+            attributeDescriptions[2].binding = 1;
+            attributeDescriptions[2].location = 2;
+            attributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[2].offset = offsetof(TileInstance, uvRect);
+
+            attributeDescriptions[3].binding = 1;
+            attributeDescriptions[3].location = 3;
+            attributeDescriptions[3].format = VK_FORMAT_R32_SINT;
+            attributeDescriptions[3].offset = offsetof(TileInstance, slot);
+
+            return attributeDescriptions;
+        }
+    };
+    static_assert(sizeof(TileInstance) == 9 * sizeof(uint32_t), "cull.comp copies instances as 9 packed words");
+
 }
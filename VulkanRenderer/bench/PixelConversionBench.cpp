@@ -0,0 +1,73 @@
+#include <PixelConversion.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Veloxr;
+
+namespace {
+    constexpr size_t PIXELS = 16 * 1024 * 1024;
+    constexpr int RUNS = 10;
+
+    // The per-byte loop every loader used before PixelConversion, kept as the baseline.
+    void referenceToRGBA8(const unsigned char* src, unsigned char* dst, size_t pixels, uint32_t channels) {
+        for (size_t i = 0; i < pixels; i++) {
+            for (uint32_t c = 0; c < channels && c < 4; c++) {
+                dst[i * 4 + c] = src[i * channels + c];
+            }
+        }
+    }
+
+    // Best of RUNS, counting bytes read plus bytes written.
+    template <typename Fn>
+    double measure(size_t bytes, Fn&& fn) {
+        double best = 1e30;
+        for (int run = 0; run < RUNS; run++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            fn();
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return bytes / best / 1e9;
+    }
+}
+
+int main() {
+    std::vector<unsigned char> src8(PIXELS * 4);
+    std::vector<uint16_t> src16(PIXELS * 4);
+    std::vector<unsigned char> dst(PIXELS * 4, 255);
+    for (size_t i = 0; i < src8.size(); i++) {
+        src8[i] = static_cast<unsigned char>(std::rand());
+        src16[i] = static_cast<uint16_t>(std::rand());
+    }
+
+    std::printf("%-10s %-12s %10s\n", "path", "conversion", "GB/s");
+    for (uint32_t channels = 1; channels <= 4; channels++) {
+        size_t bytes = PIXELS * (channels + 4);
+        double gbs = measure(bytes, [&] { referenceToRGBA8(src8.data(), dst.data(), PIXELS, channels); });
+        std::printf("%-10s %u -> 4 x8     %10.2f\n", "Reference", channels, gbs);
+    }
+
+    const PixelConversion::Path paths[] = {PixelConversion::Path::Scalar, PixelConversion::Path::SSE4,
+                                           PixelConversion::Path::AVX2, PixelConversion::Path::NEON};
+    PixelConversion::Path detected = PixelConversion::getPath();
+    for (PixelConversion::Path path : paths) {
+        if (!PixelConversion::setPath(path)) continue;
+        const char* name = PixelConversion::pathName(path);
+        for (uint32_t channels = 1; channels <= 4; channels++) {
+            size_t bytes = PIXELS * (channels + 4);
+            double gbs = measure(bytes, [&] { PixelConversion::toRGBA8(src8.data(), dst.data(), PIXELS, channels); });
+            std::printf("%-10s %u -> 4 x8     %10.2f\n", name, channels, gbs);
+        }
+        for (uint32_t channels : {1u, 3u, 4u}) {
+            size_t bytes = PIXELS * (channels * 2 + 4);
+            double gbs = measure(bytes, [&] { PixelConversion::toRGBA8(src16.data(), dst.data(), PIXELS, channels); });
+            std::printf("%-10s %u -> 4 x16    %10.2f\n", name, channels, gbs);
+        }
+    }
+    PixelConversion::setPath(detected);
+    std::printf("Runtime dispatch picks %s\n", PixelConversion::pathName(detected));
+    return 0;
+}
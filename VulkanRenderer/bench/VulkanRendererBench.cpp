@@ -0,0 +1,280 @@
+#include <benchmark/benchmark.h>
+#include <OpenImageIO/imageio.h>
+#include <PixelConversion.h>
+#include <TextureTiling.h>
+#include <ThreadPool.h>
+#include <texture.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Loader, tiling and conversion throughput on synthetic images. Besides the usual benchmark flags:
+//   --veloxr_megapixels=16,64      image sizes, square-ish 4:3
+//   --veloxr_channels=1,3,4        channel counts, JPEG skips 2 and 4
+//   --veloxr_formats=jpg,png,tif   anything OIIO can write
+//   --veloxr_threads=1,2,4,8       pool workers for the thread scaling runs, 0 is all of them
+//   --veloxr_dir=<path>            where the images are generated once and reused
+// Every run reports MP/s and the peak RSS it reached (per run on Linux, per process elsewhere).
+
+using namespace Veloxr;
+OIIO_NAMESPACE_USING
+
+namespace {
+
+    struct Options {
+        std::vector<uint32_t> megapixels{16, 64};
+        std::vector<uint32_t> channels{3, 4};
+        std::vector<std::string> formats{"jpg", "png", "tif"};
+        std::vector<uint32_t> threads{1, 2, 4, 0};
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "veloxr_bench";
+    };
+
+    struct SyntheticImage {
+        std::string path;
+        uint32_t width, height, channels;
+
+        double megapixels() const { return static_cast<double>(width) * height / 1e6; }
+    };
+
+    template <typename T, typename Parse>
+    std::vector<T> splitList(const std::string& list, Parse parse) {
+        std::vector<T> result;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) result.push_back(parse(item));
+        }
+        return result;
+    }
+
+    // Takes our flags out of argv so benchmark::Initialize only sees its own.
+    Options parseOptions(int& argc, char** argv) {
+        Options options;
+        auto toUint = [](const std::string& s) { return static_cast<uint32_t>(std::stoul(s)); };
+        auto toString = [](const std::string& s) { return s; };
+        int kept = 1;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&](const char* flag) -> const char* {
+                size_t length = std::strlen(flag);
+                return arg.compare(0, length, flag) == 0 ? argv[i] + length : nullptr;
+            };
+            if (const char* v = value("--veloxr_megapixels=")) options.megapixels = splitList<uint32_t>(v, toUint);
+            else if (const char* v = value("--veloxr_channels=")) options.channels = splitList<uint32_t>(v, toUint);
+            else if (const char* v = value("--veloxr_formats=")) options.formats = splitList<std::string>(v, toString);
+            else if (const char* v = value("--veloxr_threads=")) options.threads = splitList<uint32_t>(v, toUint);
+            else if (const char* v = value("--veloxr_dir=")) options.directory = v;
+            else argv[kept++] = argv[i];
+        }
+        argc = kept;
+        return options;
+    }
+
+    // Smooth gradients plus a little hash noise, so codecs neither collapse it nor choke on it.
+    bool writeSynthetic(const SyntheticImage& image) {
+        auto out = ImageOutput::create(image.path);
+        if (!out) {
+            std::cerr << "Could not create output: " << image.path << "\n";
+            return false;
+        }
+        ImageSpec spec(image.width, image.height, image.channels, TypeDesc::UINT8);
+        if (!out->open(image.path, spec)) {
+            std::cerr << "Could not open output " << image.path << ": " << out->geterror() << "\n";
+            return false;
+        }
+        std::vector<unsigned char> row(static_cast<size_t>(image.width) * image.channels);
+        for (uint32_t y = 0; y < image.height; y++) {
+            for (uint32_t x = 0; x < image.width; x++) {
+                uint32_t hash = (x * 73856093u) ^ (y * 19349663u);
+                for (uint32_t c = 0; c < image.channels; c++) {
+                    uint32_t gradient = c % 2 == 0 ? x * 255 / image.width : y * 255 / image.height;
+                    row[static_cast<size_t>(x) * image.channels + c] = static_cast<unsigned char>((gradient + ((hash >> (c * 4)) & 15)) & 255);
+                }
+            }
+            if (!out->write_scanline(y, 0, TypeDesc::UINT8, row.data())) {
+                std::cerr << "Error writing " << image.path << ": " << out->geterror() << "\n";
+                return false;
+            }
+        }
+        return out->close();
+    }
+
+    bool prepareImage(const Options& options, uint32_t megapixels, uint32_t channels, const std::string& format, SyntheticImage& image) {
+        // 4:3, rounded to multiples of 16 so JPEG MCUs line up
+        double pixels = megapixels * 1e6;
+        image.width = static_cast<uint32_t>(std::sqrt(pixels * 4.0 / 3.0)) / 16 * 16;
+        image.height = static_cast<uint32_t>(pixels / image.width) / 16 * 16;
+        image.channels = channels;
+        std::filesystem::create_directories(options.directory);
+        image.path = (options.directory / ("synthetic_" + std::to_string(image.width) + "x" + std::to_string(image.height) + "_" + std::to_string(channels) + "." + format)).string();
+        if (std::filesystem::exists(image.path)) return true;
+        std::cout << "Generating " << image.path << "\n";
+        if (writeSynthetic(image)) return true;
+        std::filesystem::remove(image.path);
+        return false;
+    }
+
+    // Linux can reset the high water mark, elsewhere this is the peak of the whole process.
+    void resetPeakRSS() {
+#ifdef __linux__
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        if (clearRefs) clearRefs << "5";
+#endif
+    }
+
+    double peakRSSMegabytes() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+        return counters.PeakWorkingSetSize / 1048576.0;
+#elif defined(__linux__)
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmHWM:") == 0) return std::stod(line.substr(6)) / 1024.0; // kB
+        }
+        return 0.0;
+#else
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss / 1048576.0; // Bytes on macOS
+#endif
+    }
+
+    // Common setup and reporting around one measured operation on an image.
+    void runOnImage(benchmark::State& state, const SyntheticImage& image, uint32_t threads, const std::function<void(OIIOTexture&)>& operation) {
+        ThreadPool::instance().setActiveThreadCount(threads);
+        resetPeakRSS();
+        for (auto _ : state) {
+            OIIOTexture texture(image.path);
+            if (!texture.isInitialized()) {
+                state.SkipWithError("could not open the synthetic image");
+                break;
+            }
+            operation(texture);
+        }
+        state.counters["MP/s"] = benchmark::Counter(image.megapixels(), benchmark::Counter::kIsIterationInvariantRate);
+        state.counters["peak_RSS_MB"] = peakRSSMegabytes();
+        state.counters["threads"] = ThreadPool::instance().getActiveThreadCount();
+        ThreadPool::instance().setActiveThreadCount(0);
+    }
+
+    std::string imageLabel(const std::string& format, uint32_t megapixels, uint32_t channels) {
+        return format + "/" + std::to_string(megapixels) + "MP/" + std::to_string(channels) + "ch";
+    }
+
+    void registerImageBenchmarks(const Options& options) {
+        for (const std::string& format : options.formats) {
+            for (uint32_t megapixels : options.megapixels) {
+                for (uint32_t channels : options.channels) {
+                    bool jpeg = format == "jpg" || format == "jpeg";
+                    if (jpeg && channels != 1 && channels != 3) continue;
+                    SyntheticImage image;
+                    if (!prepareImage(options, megapixels, channels, format, image)) continue;
+                    std::string label = imageLabel(format, megapixels, channels);
+
+                    // Header only, single threaded
+                    benchmark::RegisterBenchmark(("Init/" + label).c_str(), [image](benchmark::State& state) {
+                        runOnImage(state, image, 0, [](OIIOTexture&) {});
+                    })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+                    // Strategies that use the pool get one run per thread count
+                    struct Strategy {
+                        const char* name;
+                        std::function<void(OIIOTexture&)> run;
+                    };
+                    const uint64_t tileSize = 4096;
+                    const std::vector<Strategy> strategies = {
+                        {"Load", [](OIIOTexture& texture) { benchmark::DoNotOptimize(texture.load(texture.getFilename())); }},
+                        {"LoadScaled4x", [](OIIOTexture& texture) { Point size; benchmark::DoNotOptimize(texture.loadScaled(2, size)); }},
+                        {"Tile", [tileSize](OIIOTexture& texture) { TextureTiling tiler; benchmark::DoNotOptimize(tiler.tile(texture, tileSize)); }},
+                        {"Tile2", [tileSize](OIIOTexture& texture) { TextureTiling tiler; benchmark::DoNotOptimize(tiler.tile2(texture, tileSize)); }},
+                        {"Tile3", [tileSize](OIIOTexture& texture) { TextureTiling tiler; benchmark::DoNotOptimize(tiler.tile3(texture, tileSize)); }},
+                        {"Tile4", [tileSize](OIIOTexture& texture) { TextureTiling tiler; benchmark::DoNotOptimize(tiler.tile4(texture, tileSize)); }},
+                        {"Tile5", [tileSize](OIIOTexture& texture) { TextureTiling tiler; benchmark::DoNotOptimize(tiler.tile5(texture, tileSize)); }},
+                    };
+                    for (const Strategy& strategy : strategies) {
+                        for (uint32_t threads : options.threads) {
+                            std::string name = std::string(strategy.name) + "/" + label + "/threads:" + (threads ? std::to_string(threads) : "all");
+                            auto run = strategy.run;
+                            benchmark::RegisterBenchmark(name.c_str(), [image, threads, run](benchmark::State& state) {
+                                runOnImage(state, image, threads, run);
+                            })->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Decoded scanlines to RGBA8, the step every loader ends with.
+    void BM_ChannelConversion(benchmark::State& state) {
+        uint32_t channels = static_cast<uint32_t>(state.range(0));
+        uint32_t sampleBytes = static_cast<uint32_t>(state.range(1));
+        const size_t pixels = 16u << 20;
+        std::vector<unsigned char> src(pixels * channels * sampleBytes);
+        for (size_t i = 0; i < src.size(); i++) src[i] = static_cast<unsigned char>(i * 2654435761u >> 24);
+        std::vector<unsigned char> dst(pixels * 4);
+        for (auto _ : state) {
+            PixelConversion::toRGBA8(src.data(), sampleBytes, dst.data(), pixels, channels);
+            benchmark::ClobberMemory();
+        }
+        state.SetLabel(PixelConversion::pathName(PixelConversion::getPath()));
+        state.counters["MP/s"] = benchmark::Counter(pixels / 1e6, benchmark::Counter::kIsIterationInvariantRate);
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(pixels * (channels * sampleBytes + 4)));
+    }
+
+    // What submitTileUploads does per tile: copy its pixels into the mapped staging ring, wrapping at
+    // the end. Plain host memory stands in for the mapping, there is no device here.
+    void BM_StagingCopy(benchmark::State& state) {
+        const size_t tileSize = static_cast<size_t>(state.range(0));
+        const size_t ringSize = 128ull << 20;
+        const size_t tileBytes = tileSize * tileSize * 4;
+        std::vector<unsigned char> ring(ringSize);
+        std::vector<unsigned char> tile(tileBytes, 7);
+        size_t head = 0;
+        for (auto _ : state) {
+            if (head + tileBytes > ringSize) head = 0;
+            std::memcpy(ring.data() + head, tile.data(), tileBytes);
+            head = (head + tileBytes + 255) & ~size_t(255);
+            benchmark::ClobberMemory();
+        }
+        state.counters["MP/s"] = benchmark::Counter(tileSize * tileSize / 1e6, benchmark::Counter::kIsIterationInvariantRate);
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(tileBytes));
+    }
+
+}
+
+BENCHMARK(BM_ChannelConversion)->ArgsProduct({{1, 2, 3, 4}, {1, 2}})->ArgNames({"channels", "sample_bytes"});
+BENCHMARK(BM_StagingCopy)->Arg(512)->Arg(1024)->Arg(2048)->Arg(4096)->ArgName("tile");
+
+int main(int argc, char** argv) {
+    Options options = parseOptions(argc, argv);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    benchmark::AddCustomContext("pool_workers", std::to_string(ThreadPool::instance().getThreadCount()));
+    benchmark::AddCustomContext("conversion_path", PixelConversion::pathName(PixelConversion::getPath()));
+    registerImageBenchmarks(options);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
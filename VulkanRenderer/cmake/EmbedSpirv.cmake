@@ -0,0 +1,28 @@
+# Writes the SPIR-V that the Shaders target compiled into a header of constexpr word arrays,
+# one per shader, so the library never reads shaders from disk. Run as
+#   cmake -DSPIRV_DIR=<dir> -DSHADERS=<name>,<name>... -DOUTPUT=<header> -P EmbedSpirv.cmake
+# where <dir>/<name>.spv becomes Veloxr::Shaders::<name>.
+
+string(REPLACE "," ";" shaders "${SHADERS}")
+# CMake regexes have no {n}
+string(REPEAT "0x[0-9a-f]+u, " 8 line)
+
+set(content "// Generated by EmbedSpirv.cmake, do not edit.\n#pragma once\n#include <cstdint>\n\nnamespace Veloxr::Shaders {\n")
+foreach(name IN LISTS shaders)
+    set(spirv "${SPIRV_DIR}/${name}.spv")
+    file(READ "${spirv}" hex HEX)
+    string(LENGTH "${hex}" length)
+    math(EXPR remainder "${length} % 8")
+    if(length EQUAL 0 OR NOT remainder EQUAL 0)
+        message(FATAL_ERROR "${spirv} is not SPIR-V, its size is not a multiple of 4 bytes")
+    endif()
+
+    # glslc writes little endian words, reassemble them eight to a line
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " words "${hex}")
+    string(REGEX REPLACE "(${line})" "\\1\n        " words "${words}")
+    string(REPLACE ", \n" ",\n" words "${words}")
+    string(STRIP "${words}" words)
+    string(APPEND content "\n    inline constexpr uint32_t ${name}[] = {\n        ${words}\n    };\n")
+endforeach()
+string(APPEND content "\n}\n")
+file(WRITE "${OUTPUT}" "${content}")
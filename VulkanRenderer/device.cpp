@@ -1,10 +1,25 @@
 #include "device.h"
+#include <algorithm>
 #include <map>
 
 using namespace Veloxr;
 
-Device::Device(VkInstance instance, VkSurfaceKHR surface, bool enableValidationLayers): _instance(instance), _surface(surface), _enableValidationLayers(enableValidationLayers) {
+namespace {
+    // Prefer a transfer-only family (the DMA engine), then any non-graphics one that can copy.
+    std::optional<uint32_t> findTransferFamily(const std::vector<VkQueueFamilyProperties>& queueFamilies) {
+        std::optional<uint32_t> fallback;
+        for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+            VkQueueFlags flags = queueFamilies[i].queueFlags;
+            if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) continue;
+            if (!(flags & VK_QUEUE_COMPUTE_BIT)) return i;
+            if (!fallback.has_value()) fallback = i;
+        }
+        return fallback;
+    }
+}
 
+Device::Device(VkInstance instance, VkSurfaceKHR surface, bool enableValidationLayers): _instance(instance), _surface(surface), _enableValidationLayers(enableValidationLayers) {
+    if (isHeadless()) deviceExtensions.clear();
 }
 
 
@@ -13,11 +28,58 @@ void Device::create() {
     _createLogicalDevice();
 }
 
+void Device::adopt(const ExternalDevice& external) {
+    _external = true;
+    _physicalDevice = external.physicalDevice;
+    _logicalDevice = external.device;
+    _graphicsQueue = _presentQueue = _transferQueue = external.queue;
+    _queueFamilies.graphicsFamily = _queueFamilies.presentFamily = _queueFamilies.transferFamily = external.queueFamily;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
+    _maxTextureResolution = deviceProperties.limits.maxImageDimension2D;
+
+    // Qt's RHI enables every core feature the device supports (robustBufferAccess aside), so these hold.
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+    _samplerAnisotropy = supportedFeatures.samplerAnisotropy == VK_TRUE;
+    _maxSamplerAnisotropy = _samplerAnisotropy ? deviceProperties.limits.maxSamplerAnisotropy : 1.0f;
+    _textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+
+    // Descriptor indexing needs an extension and a feature struct we cannot see on someone else's
+    // device, the renderer takes the texture array path.
+    _descriptorIndexing = false;
+    _maxBindlessTextures = 0;
+    // A physical device query, supported is enough even if the owner did not enable the extension.
+    _memoryBudget = deviceProperties.apiVersion >= VK_API_VERSION_1_1 && _hasDeviceExtension(_physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    std::cout << "Adopted external device " << deviceProperties.deviceName << ", queue family " << external.queueFamily << std::endl;
+}
+
+bool Device::getDeviceLocalBudget(VkDeviceSize& budget, VkDeviceSize& usage) const {
+    if (!_memoryBudget) return false;
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+    memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties.pNext = &budgetProperties;
+    vkGetPhysicalDeviceMemoryProperties2(_physicalDevice, &memoryProperties);
+
+    budget = 0;
+    usage = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryProperties.memoryHeapCount; i++) {
+        if (!(memoryProperties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+        budget += budgetProperties.heapBudget[i];
+        usage += budgetProperties.heapUsage[i];
+    }
+    return budget > 0;
+}
+
 void Device::_createLogicalDevice() {
 
     QueueFamilyIndices indices = findQueueFamilies(_physicalDevice);
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value()};
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -29,10 +91,69 @@ void Device::_createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+
+    // Anisotropy is optional, samplers fall back to plain trilinear without it.
     VkPhysicalDeviceFeatures deviceFeatures{};
+    deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+    _samplerAnisotropy = supportedFeatures.samplerAnisotropy == VK_TRUE;
+    if (_samplerAnisotropy) {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
+        _maxSamplerAnisotropy = deviceProperties.limits.maxSamplerAnisotropy;
+    }
+    // BC formats are optional too (most mobile GPUs lack them), tiles stay RGBA8 without it.
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    _textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+
+    // Bindless tiles need descriptor indexing, the renderer falls back to a texture array without it.
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
+    if (deviceProperties.apiVersion >= VK_API_VERSION_1_1 && _hasDeviceExtension(_physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(_physicalDevice, &features2);
+
+        VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+        indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &indexingProperties;
+        vkGetPhysicalDeviceProperties2(_physicalDevice, &properties2);
+
+        _descriptorIndexing = indexingFeatures.runtimeDescriptorArray &&
+            indexingFeatures.descriptorBindingPartiallyBound &&
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+            indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+        _maxBindlessTextures = std::min(indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT enabledIndexing{};
+    enabledIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (_descriptorIndexing) {
+        enabledIndexing.runtimeDescriptorArray = VK_TRUE;
+        enabledIndexing.descriptorBindingPartiallyBound = VK_TRUE;
+        enabledIndexing.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        enabledIndexing.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        enabledIndexing.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+        enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    }
+
+    // Lets the texture pool size itself from what the driver says is left instead of a guess.
+    _memoryBudget = deviceProperties.apiVersion >= VK_API_VERSION_1_1 && _hasDeviceExtension(_physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (_memoryBudget) enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = _descriptorIndexing ? &enabledIndexing : nullptr;
 
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -47,8 +168,8 @@ void Device::_createLogicalDevice() {
         createInfo.enabledLayerCount = 0;
     }
 
-    createInfo.enabledExtensionCount = (uint32_t)deviceExtensions.size();
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = (uint32_t)enabledExtensions.size();
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 
     if (vkCreateDevice(_physicalDevice, &createInfo, nullptr, &_logicalDevice) != VK_SUCCESS) {
@@ -58,8 +179,11 @@ void Device::_createLogicalDevice() {
 
     vkGetDeviceQueue(_logicalDevice, indices.graphicsFamily.value(), 0, &_graphicsQueue);
     vkGetDeviceQueue(_logicalDevice, indices.presentFamily.value(), 0, &_presentQueue);
+    vkGetDeviceQueue(_logicalDevice, indices.transferFamily.value(), 0, &_transferQueue);
+    _queueFamilies = indices;
 
-    std::cout << "Finished logical device creation! Queue / Present indices: " << indices.graphicsFamily.value() << " " << indices.presentFamily.value() << std::endl;
+    std::cout << "Finished logical device creation! Queue / Present / Transfer indices: " << indices.graphicsFamily.value() << " " << indices.presentFamily.value() << " " << indices.transferFamily.value()
+              << ", descriptor indexing " << (_descriptorIndexing ? "yes" : "no") << " (max bindless textures " << _maxBindlessTextures << ")" << std::endl;
 
 }
 
@@ -77,13 +201,18 @@ Veloxr::QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) co
     for (const auto& queueFamily : queueFamilies) {
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
+        if (isHeadless()) {
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE; // Nothing is presented
+        } else {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
+        }
 
         if (presentSupport) {
             indices.presentFamily = i;
         }
 
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        // Frames also record the tile cull dispatch
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
             indices.graphicsFamily = i;
         }
 
@@ -92,6 +221,9 @@ Veloxr::QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) co
         i++;
     }
 
+    indices.transferFamily = findTransferFamily(queueFamilies);
+    if (!indices.transferFamily.has_value()) indices.transferFamily = indices.graphicsFamily;
+
     return indices;
 }
 QueueFamilyIndices Device::_findQueueFamilies(VkPhysicalDevice device) {
@@ -108,13 +240,18 @@ QueueFamilyIndices Device::_findQueueFamilies(VkPhysicalDevice device) {
     for (const auto& queueFamily : queueFamilies) {
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
+        if (isHeadless()) {
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE; // Nothing is presented
+        } else {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
+        }
 
         if (presentSupport) {
             indices.presentFamily = i;
         }
 
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        // Frames also record the tile cull dispatch
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
             indices.graphicsFamily = i;
         }
 
@@ -123,6 +260,9 @@ QueueFamilyIndices Device::_findQueueFamilies(VkPhysicalDevice device) {
         i++;
     }
 
+    indices.transferFamily = findTransferFamily(queueFamilies);
+    if (!indices.transferFamily.has_value()) indices.transferFamily = indices.graphicsFamily;
+
     return indices;
 }
 
@@ -144,11 +284,13 @@ int Device::_calculateDeviceScore(VkPhysicalDevice device) {
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
     bool swapChainAdequate = false;
-    SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-    swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
-    if(!swapChainAdequate) {
-        std::cerr << "Device " << device << " does not contained swapChain needs.\n";
-        return -1;
+    if (!isHeadless()) {
+        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+        if(!swapChainAdequate) {
+            std::cerr << "Device " << device << " does not contained swapChain needs.\n";
+            return -1;
+        }
     }
     std::cout << "Device " << device << " ready to score.\n";
 
@@ -163,6 +305,10 @@ int Device::_calculateDeviceScore(VkPhysicalDevice device) {
     if(deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
         score *= 2;
     }
+    // Software rasterizers report GPU sized limits, never let one win unless it was asked for.
+    if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+        score = _preferSoftwareDevice ? score + (1 << 24) : score / 4;
+    }
     std::cout << "Score for device " << deviceProperties.deviceID << " (" << deviceProperties.deviceName << ") = " << score << std::endl;
     return score;
 }
@@ -183,6 +329,19 @@ bool Device::_checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+bool Device::_hasDeviceExtension(VkPhysicalDevice device, const char* name) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (std::string(extension.extensionName) == name) return true;
+    }
+    return false;
+}
+
 SwapChainSupportDetails Device::querySwapChainSupport(VkPhysicalDevice device) const {
     SwapChainSupportDetails details;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, _surface, &details.capabilities);
@@ -233,4 +392,13 @@ void Device::_pickPhysicalDevice() {
     if (_physicalDevice == VK_NULL_HANDLE) {
         throw std::runtime_error("failed to find a suitable GPU!");
     }
+    // Scoring ran over every device, keep the limits of the one we picked.
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
+    _maxTextureResolution = deviceProperties.limits.maxImageDimension2D;
+    if (_preferSoftwareDevice) {
+        if (deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_CPU) {
+            std::cerr << "No CPU Vulkan implementation found, using " << deviceProperties.deviceName << "\n";
+        }
+    }
 }
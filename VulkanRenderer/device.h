@@ -14,11 +14,25 @@ namespace Veloxr {
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // Dedicated transfer (DMA) family when the device has one, the graphics family otherwise.
+    std::optional<uint32_t> transferFamily;
 
     // Is complete if their are graphics commands supported
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
     }
+
+    bool hasDedicatedTransfer() const {
+        return transferFamily.has_value() && transferFamily != graphicsFamily;
+    }
+};
+
+// A device someone else created and keeps owning, e.g. the one behind Qt Quick's scene graph.
+struct ExternalDevice {
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    VkQueue queue;
+    uint32_t queueFamily;
 };
 
 struct SwapChainSupportDetails {
@@ -34,11 +48,21 @@ class VULKANRENDERER_EXPORT Device {
         VkSurfaceKHR _surface;
         VkPhysicalDevice _physicalDevice;
         VkDevice _logicalDevice;
-        VkQueue _graphicsQueue, _presentQueue;
+        VkQueue _graphicsQueue, _presentQueue, _transferQueue;
         bool _enableValidationLayers;
         uint32_t _maxTextureResolution;
-
-        const std::vector<const char*> deviceExtensions = {
+        bool _samplerAnisotropy{false};
+        float _maxSamplerAnisotropy{1.0f};
+        bool _textureCompressionBC{false};
+        bool _descriptorIndexing{false};
+        uint32_t _maxBindlessTextures{0};
+        bool _preferSoftwareDevice{false};
+        bool _external{false};
+        bool _memoryBudget{false};
+        QueueFamilyIndices _queueFamilies;
+
+        // Emptied without a surface, a headless device never presents.
+        std::vector<const char*> deviceExtensions = {
             VK_KHR_SWAPCHAIN_EXTENSION_NAME
         };
 
@@ -52,21 +76,44 @@ class VULKANRENDERER_EXPORT Device {
         void _createLogicalDevice();
         int _calculateDeviceScore(VkPhysicalDevice device);
         bool _checkDeviceExtensionSupport(VkPhysicalDevice device);
+        bool _hasDeviceExtension(VkPhysicalDevice device, const char* name);
 
 
 
     public:
         Device(VkInstance instance, VkSurfaceKHR surface, bool enableValidationLayers = false);
 
+        // A null surface creates a headless device, present queries are skipped and present maps to graphics.
         void create();
+        // Pick a CPU implementation (lavapipe, SwiftShader) over any GPU, call before create().
+        inline void setPreferSoftwareDevice(bool prefer) { _preferSoftwareDevice = prefer; }
+        // Instead of create(). Graphics, present and transfer all map to its one queue, optional
+        // features are only reported where the owner is known to have enabled them.
+        void adopt(const ExternalDevice& external);
 
         QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) const ;
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device) const ;
+        // The families the logical device was created (or adopted) with.
+        inline const QueueFamilyIndices& getQueueFamilies() const { return _queueFamilies; }
 
         inline VkPhysicalDevice getPhysicalDevice() const { return _physicalDevice; }
         inline VkDevice getLogicalDevice() const { return _logicalDevice; }
         inline VkQueue getGraphicsQueue() const { return _graphicsQueue; }
         inline VkQueue getPresentationQueue() const { return _presentQueue; }
+        inline VkQueue getTransferQueue() const { return _transferQueue; }
         inline uint32_t getMaxTextureResolution() const { return _maxTextureResolution; }
+        inline bool supportsSamplerAnisotropy() const { return _samplerAnisotropy; }
+        inline float getMaxSamplerAnisotropy() const { return _maxSamplerAnisotropy; }
+        inline bool supportsTextureCompressionBC() const { return _textureCompressionBC; }
+        // Partially bound, update-after-bind sampled image arrays with non-uniform indexing.
+        inline bool supportsDescriptorIndexing() const { return _descriptorIndexing; }
+        inline uint32_t getMaxBindlessTextures() const { return _maxBindlessTextures; }
+        // VK_EXT_memory_budget, what the driver lets this process use of the device local heaps right now.
+        inline bool supportsMemoryBudget() const { return _memoryBudget; }
+        // Summed over device local heaps, usage includes every allocation of this process. False without the extension.
+        bool getDeviceLocalBudget(VkDeviceSize& budget, VkDeviceSize& usage) const;
+        inline bool isHeadless() const { return _surface == VK_NULL_HANDLE; }
+        // Adopted, the caller must not destroy the device.
+        inline bool isExternal() const { return _external; }
 }; 
 }
@@ -1,6 +1,7 @@
 #include <renderer.h>
-int main() {
+int main(int argc, char** argv) {
     RendererCore app{};
+    if (argc > 1) app.setInitialImage(argv[1]);
 
     try {
         app.run();
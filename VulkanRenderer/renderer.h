@@ -5,12 +5,17 @@
 #include <unordered_map>
 #define CV_IO_MAX_IMAGE_PIXELS 40536870912
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <functional>
+#include <future>
 #include <glm/ext/matrix_transform.hpp>
 #include <map>
 #include <optional>
 #include <queue>
 #include <set>
+#include <thread>
 #include <utility>
 #include <vulkan/vulkan_core.h>
 #include <OrthographicCamera.h>
@@ -19,6 +24,17 @@
 #include <texture.h>
 #include <Vertex.h>
 #include <TextureTiling.h>
+#include <TileResidency.h>
+#include <TexturePool.h>
+#include <TileCache.h>
+#include <StagingRing.h>
+#include <MemoryAllocator.h>
+#include <BlockCompression.h>
+#include <ThreadPool.h>
+#include <BoundedQueue.h>
+#include <FrameStats.h>
+#include <PipelineCache.h>
+#include <EmbeddedShaders.h>
 
 
 
@@ -54,6 +70,21 @@
 #define MAX_FRAMES_IN_FLIGHT 2
 #endif
 
+// Upper bound on resident tiles, the bindless array and the fallback texture array are sized from the device below this.
+#ifndef MAX_TILE_SLOTS
+#define MAX_TILE_SLOTS 4096
+#endif
+
+// Frames between checks of the texture pool against VK_EXT_memory_budget.
+#ifndef POOL_TRIM_INTERVAL
+#define POOL_TRIM_INTERVAL 64
+#endif
+
+// Longest side of the progressive open preview, it only has to look right until the fallback tile lands.
+#ifndef MAX_PREVIEW_SIZE
+#define MAX_PREVIEW_SIZE 1024u
+#endif
+
 #include <opencv4/opencv2/opencv.hpp>
 #define CV_IO_MAX_IMAGE_PIXELS 40536870912
 
@@ -78,21 +109,6 @@
 #else
 #define PREFIX std::string("/mnt/c")
 #endif
-static std::vector<char> readFile(const std::string& filename) {
-    std::cout << "Loading file: " << filename << std::endl;
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file!");
-    }
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-
-    return buffer;
-}
 
 inline void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator) {
     auto func = (PFN_vkDestroyDebugUtilsMessengerEXT) vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
@@ -112,10 +128,6 @@ inline VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugU
 }
 
 
-inline const auto LEFT = -0.9f;
-inline const auto RIGHT = 0.9f;
-inline const auto TOP = -0.9f;
-inline const auto BOT = 0.9f;
 // TODO:
 //      - Alpha layer transparency
 //          - Where there are no colors, but there is an alpha layer, fill with alpha checkerboard
@@ -125,24 +137,33 @@ inline const auto BOT = 0.9f;
 //      - Aspect Ratio
 //      - Return parsable coordinates of what is being viewed.
 //          - 
-inline std::vector<Veloxr::Vertex> vertices = {
-    {{RIGHT, BOT, 0, 0}, {1.0f, 1.0f, 1, 0}, 0},
-    {{LEFT, BOT, 0, 0}, {0.0f, 1.0f, 1, 0}, 0},
-    {{LEFT, TOP, 0, 0}, {0.0f, 0.0f, 1, 0}, 0},
-
-    {{LEFT, TOP, 0, 0}, {0.0f, 0.0f, 0, 0}, 0},
-    {{RIGHT, TOP, 0, 0}, {1.0f, 0.0f, 0, 0}, 0},
-    {{RIGHT, BOT, 0, 0}, {1.0f, 1.0f, 0, 0}, 0},
-};
+// Every tile is an instance of this, stretched over its rect in the vertex shader.
+inline const std::array<Veloxr::QuadVertex, 6> unitQuad = {{
+    {{1.0f, 1.0f}},
+    {{0.0f, 1.0f}},
+    {{0.0f, 0.0f}},
+
+    {{0.0f, 0.0f}},
+    {{1.0f, 0.0f}},
+    {{1.0f, 1.0f}},
+}};
 
 
+// Read by recorded command buffers, so camera moves do not need a re-record.
 struct UniformBufferObject {
-    alignas(16) glm::mat4 model;
-    alignas(16) glm::mat4 view;
-    alignas(16) glm::mat4 proj;
-    alignas(16) glm::vec4 time;
+    alignas(16) glm::mat4 viewProj;
 };
 
+// Push constants of shaders/cull.comp, which is dispatched once per draw layer.
+struct CullConstants {
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+    uint32_t layer;
+};
+
+// The preview plus one layer per pyramid level, a uint32 extent has at most 33 levels.
+constexpr uint32_t MAX_DRAW_LAYERS = 34;
+
 inline bool mousePressed = false;
 inline double lastX = 0.0, lastY = 0.0;
 
@@ -164,6 +185,11 @@ class RendererCore {
 public:
 
     float deltaMs;
+    // Loader tasks may still be running when a caller skipped destroy(), they only touch CPU state.
+    ~RendererCore() {
+        _tileLoads.wait();
+        _previewLoads.wait();
+    }
     void run() {
         init();
         render();
@@ -173,17 +199,129 @@ public:
         _windowWidth = width;
         _windowHeight = height;
         frameBufferResized = true;
+        requestRedraw();
     }
     /*const*/Veloxr::OrthographicCamera& getCamera() {
         return _camera;
     }
+    // Device memory the tile streamer may keep resident, takes effect on the next openImage().
+    void setResidencyBudget(uint64_t bytes) {
+        _residencyBudget = bytes;
+    }
+    void setStreamingTileSize(uint32_t tileSize) {
+        _streamingTileSize = tileSize;
+    }
+    // Pre-tiled pyramids are kept here, empty stores them next to the source image.
+    void setTileCacheDirectory(const std::string& directory) {
+        _tileCacheDirectory = directory;
+    }
+    // Compiled pipelines are kept here between runs, empty uses the per-user cache directory. Before init().
+    void setPipelineCacheDirectory(const std::string& directory) {
+        _pipelineCacheDirectory = directory;
+    }
+    // Opened at the end of init(). Empty (the default) starts without an image, a file that fails to
+    // open is logged and leaves the renderer empty too; openImage() can be called at any time after.
+    void setInitialImage(const std::string& filepath) {
+        _initialImagePath = filepath;
+    }
+    void setTileCacheEnabled(bool enabled) {
+        _tileCacheEnabled = enabled;
+    }
+    // Streams tiles as BC7 (images with alpha) or BC1, encoded on the loader threads and cached on disk.
+    // Ignored on devices without BC support, takes effect on the next openImage().
+    void setTileCompression(bool enabled) {
+        _tileCompressionEnabled = enabled;
+    }
+    // Shows the embedded thumbnail or a decimated preview while the coarsest tile is still decoding.
+    // Takes effect on the next openImage().
+    void setProgressiveOpen(bool enabled) {
+        _progressiveOpen = enabled;
+    }
+    // Device memory for the tiles of every image, the open one's residency budget included. Tiles of
+    // images opened before stay resident within it, least recently viewed go first, so switching back
+    // to one shows it without a reload. 0 (the default) allows four residency budgets, either way capped
+    // by what VK_EXT_memory_budget reports as left. Takes effect on the next openImage().
+    void setTexturePoolBudget(uint64_t bytes) {
+        _texturePoolBudget = bytes;
+    }
+    // Host-visible staging shared by all tile uploads, takes effect on init().
+    void setStagingRingSize(uint64_t bytes) {
+        _stagingRingSize = bytes;
+    }
+    // No window, surface or swapchain: frames go to a width x height offscreen image, see renderOffscreen().
+    // Call before init(), setWindowDimensions() resizes the image afterwards.
+    void setHeadless(uint32_t width, uint32_t height) {
+        _headless = true;
+        setWindowDimensions(static_cast<int>(width), static_cast<int>(height));
+    }
+    // Prefer a CPU Vulkan implementation such as lavapipe, for machines without a GPU. Takes effect on init().
+    void setSoftwareRendering(bool enabled) {
+        _softwareRendering = enabled;
+    }
+
+    // On demand (the default) the host only calls drawFrame() while needsRedraw() holds. Camera moves,
+    // resizes, tile set changes and pending uploads keep it set, setAnimating() forces it on.
+    void setOnDemandRendering(bool enabled) {
+        _onDemand = enabled;
+    }
+    void setAnimating(bool animating) {
+        _animating = animating;
+        if (animating) requestRedraw();
+    }
+    // Called from any thread when something arrives that the next frame should show, e.g. a decoded
+    // tile. The host wakes its loop from it (glfwPostEmptyEvent, QQuickWindow::update).
+    void setRedrawCallback(std::function<void()> callback) {
+        _redrawCallback = std::move(callback);
+    }
+    void requestRedraw() {
+        _redrawRequested.store(true, std::memory_order_release);
+        if (_redrawCallback) _redrawCallback();
+    }
+    // Timings of the last drawn frame plus rolling percentiles, see Veloxr::FrameStats.
+    const Veloxr::FrameStats& getFrameStats() const {
+        return _frameStats;
+    }
+    bool needsRedraw() const {
+        if (!_onDemand || _animating || frameBufferResized) return true;
+        if (_redrawRequested.load(std::memory_order_acquire)) return true;
+        if (_camera.getVersion() != _drawnCameraVersion || _tileSetVersion != _drawnTileSetVersion) return true;
+        // Work only a frame can move along, decodes waiting for ring space and uploads waiting to be acquired.
+        return !_decodedTiles.empty() || !_pendingAcquires.empty() || !_uploadWaitSemaphores.empty();
+    }
+
+    enum class SamplerMode {
+        Nearest,     // Base level only, no filtering
+        Trilinear,   // Linear within and between mip levels
+        Anisotropic  // Trilinear plus the device's max anisotropy, trilinear if unsupported
+    };
+
+    // Tiles share one sampler, each frame picks up the new one as it is refreshed and the old one is retired with the frame.
+    void setSamplerMode(SamplerMode mode) {
+        if (mode == _samplerMode) return;
+        _samplerMode = mode;
+        if (device == VK_NULL_HANDLE) return;
+
+        VkVirtualTexture retired{};
+        retired.textureSampler = _tileSampler;
+        _retiredTextures.push_back({submittedFrames, retired});
+        _tileSampler = createTextureSampler();
+        _tileSetVersion++;
+    }
 
 private: // No client
 
-    GLFWwindow* window;
+    GLFWwindow* window = nullptr;
     const int WIDTH = 1920;
     const int HEIGHT = 1080;
     int _windowWidth, _windowHeight;
+    bool _headless = false;
+    bool _external = false; // initExternal(), the host samples our image and submits our commands
+    bool _softwareRendering = false;
+
+    // Both draw into a single image of our own instead of a swapchain.
+    bool rendersOffscreen() const {
+        return _headless || _external;
+    }
 
 private: // Client
 
@@ -202,50 +340,191 @@ private: // Client
 
     std::unique_ptr<Veloxr::Device> _deviceUtils;
 
-    VkSurfaceKHR surface;
-    VkDevice device;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
     VkPhysicalDevice physicalDevice;
-    VkQueue graphicsQueue, presentQueue;
+    VkQueue graphicsQueue, presentQueue, transferQueue;
+    uint32_t graphicsQueueFamily, transferQueueFamily;
+    bool dedicatedTransfer = false;
     VkSwapchainKHR swapChain;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
     VkColorSpaceKHR swapChainColorSpace;
-    std::vector<VkImage> swapChainImages;
+    std::vector<VkImage> swapChainImages; // Headless and external: just the offscreen image
     std::vector<VkImageView> swapChainImageViews;
+    Veloxr::MemoryAllocation _offscreenImageMemory;
 
     VkRenderPass renderPass;
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout; // Uniforms in shaders object
     VkPipeline graphicsPipeline;
+    // Compute pass that compacts the visible tile instances and writes the indirect draws.
+    VkDescriptorSetLayout cullDescriptorSetLayout;
+    VkPipelineLayout cullPipelineLayout;
+    VkPipeline cullPipeline;
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkCommandPool commandPool;
-    std::vector<VkCommandBuffer> commandBuffers;
+    VkCommandPool transferCommandPool;
+    std::vector<VkCommandBuffer> commandBuffers; // Per frame: timer start and tile acquires, re-recorded every frame
+    // Per frame in flight and swapchain image: cull pass and render pass, re-recorded only when that
+    // frame's tile set changed or the swapchain was recreated.
+    std::vector<VkCommandBuffer> frameCommandBuffers;
+    std::vector<std::optional<uint64_t>> frameCommandBufferTileSets;
     uint32_t currentFrame = 0;
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    uint64_t submittedFrames = 0;
+
+    // Device local, written once.
+    VkBuffer quadBuffer = VK_NULL_HANDLE;
+    Veloxr::MemoryAllocation quadBufferMemory{};
+    // Host visible, one per frame in flight. When the resident tile set changes only the instances
+    // that differ from what that frame last drew are written.
+    std::vector<VkBuffer> instanceBuffers;
+    std::vector<Veloxr::MemoryAllocation> instanceBuffersMemory;
+    std::vector<void*> instanceBuffersMapped;
+    std::vector<VkDeviceSize> instanceBuffersCapacity;
+    // Device local, written by the cull pass every frame: the instances on screen and their draws.
+    std::vector<VkBuffer> visibleInstanceBuffers;
+    std::vector<Veloxr::MemoryAllocation> visibleInstanceBuffersMemory;
+    std::vector<VkBuffer> drawCommandBuffers; // MAX_DRAW_LAYERS indirect draws
+    std::vector<Veloxr::MemoryAllocation> drawCommandBuffersMemory;
+    std::array<std::vector<Veloxr::TileInstance>, MAX_FRAMES_IN_FLIGHT> _frameInstances;
+    std::vector<Veloxr::TileInstance> _tileInstances;
+    // First instance of every draw layer, the preview's and then one per level from coarse to fine
+    std::array<std::vector<uint32_t>, MAX_FRAMES_IN_FLIGHT> _frameLayerStarts;
+    std::vector<uint32_t> _tileLayerStarts;
+    uint32_t _maxCullWorkgroups = 65535;
 
     std::vector<VkBuffer> uniformBuffers;
-    std::vector<VkDeviceMemory> uniformBuffersMemory;
+    std::vector<Veloxr::MemoryAllocation> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
     VkDescriptorPool descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
+    VkDescriptorPool cullDescriptorPool;
+    std::vector<VkDescriptorSet> cullDescriptorSets;
 
     struct VkVirtualTexture {
         VkImage textureImage;
-        VkDeviceMemory textureImageMemory;
+        Veloxr::MemoryAllocation textureImageMemory;
         VkImageView textureImageView;
         VkSampler textureSampler;
         Veloxr::OIIOTexture textureData;
 
-        void destroy(VkDevice device) {
+        void destroy(VkDevice device, Veloxr::MemoryAllocator& allocator) {
             vkDestroySampler(device, textureSampler, nullptr);
             vkDestroyImageView(device, textureImageView, nullptr);
             vkDestroyImage(device, textureImage, nullptr);
-            vkFreeMemory(device, textureImageMemory, nullptr);
+            allocator.free(textureImageMemory);
         }
     };
 
     std::map<std::string, VkVirtualTexture> _textureMap;
+
+    // Streaming
+    struct StreamedTile {
+        VkVirtualTexture texture; // Empty in texture array mode, the pixels live in _tileArray
+        uint32_t slot;            // Bindless array index or texture array layer
+        uint32_t width, height;
+    };
+
+    Veloxr::OIIOTexture _sourceTexture;
+    Veloxr::TileResidency _residency;
+    std::unordered_map<Veloxr::TileKey, StreamedTile, Veloxr::TileKeyHash> _residentTiles;
+    // Tiles of images opened earlier, they keep their slots until trimmed or reopened.
+    Veloxr::TexturePool<StreamedTile> _texturePool;
+    std::string _openImagePath;
+    Veloxr::SourceStamp _openImageSource; // Taken at open, parked tiles are only valid for that file
+    uint64_t _texturePoolBudget = 0;
+    uint32_t _texturePoolMaxTiles = 0; // Slots the open image is guaranteed are left to it
+    uint64_t _nextPoolTrim = 0;        // Submitted frame count of the next memory budget check
+    std::vector<std::pair<uint64_t, VkVirtualTexture>> _retiredTextures; // Submitted frame count at eviction
+    std::vector<uint32_t> _freeTileSlots;
+    std::vector<std::pair<uint64_t, uint32_t>> _retiredTileSlots; // Submitted frame count at eviction
+    VkSampler _tileSampler = VK_NULL_HANDLE;
+    // Descriptor indexing: one sampled image per slot, written once when the tile lands.
+    // Without it every tile is a layer of _tileArray, a single sampler2DArray.
+    bool _bindless = false;
+    uint32_t _tileSlotCount = 0;
+    VkVirtualTexture _tileArray{};
+    VkFormat _tileArrayFormat = VK_FORMAT_UNDEFINED;
+    uint32_t _tileArrayExtent = 0;
+    uint32_t _tileArrayMipLevels = 1;
+    uint64_t _residencyBudget = 512ull * 1024 * 1024;
+    uint32_t _streamingTileSize = 2048;
+    Veloxr::TileCache _tileCache;
+    std::string _tileCacheDirectory;
+    std::string _initialImagePath;
+    std::string _pipelineCacheDirectory;
+    Veloxr::PipelineCache _pipelineCache;
+    bool _tileCacheEnabled = true;
+    // Compressed tiles come with their mip chain and are written to their own cache as they are encoded,
+    // _tileCache then stays closed.
+    bool _tileCompressionEnabled = false;
+    Veloxr::TileFormat _tileFormat = Veloxr::TileFormat::RGBA8;
+    Veloxr::TileCache _compressedCache;
+    // Loader tasks hand finished tiles to the render thread as soon as they are decoded. The residency
+    // caps loads in flight below the queue capacity, so a push only fails if that invariant breaks.
+    using DecodedTile = std::pair<Veloxr::TileKey, Veloxr::TextureData>;
+    uint32_t _maxLoadsInFlight = std::max(4u, Veloxr::ThreadPool::instance().getThreadCount());
+    Veloxr::BoundedQueue<DecodedTile> _decodedQueue{_maxLoadsInFlight * 2};
+    // Loader threads only touch the flag and callback of the on-demand state.
+    std::atomic<bool> _redrawRequested{true};
+    std::function<void()> _redrawCallback;
+    Veloxr::TaskGroup _tileLoads{Veloxr::TaskPriority::High}; // Declared after everything its tasks touch
+    // Progressive open: the preview covers the whole image until the fallback tile is resident.
+    bool _progressiveOpen = true;
+    Veloxr::TaskGroup _previewLoads{Veloxr::TaskPriority::High}; // Awaited whole, the future is ready before the task returns
+    std::future<Veloxr::TextureData> _previewLoad;
+    Veloxr::TextureData _previewData; // Decoded, waiting for a slot and ring space
+    std::optional<StreamedTile> _previewTile;
+    SamplerMode _samplerMode = SamplerMode::Trilinear;
+    bool _linearBlitSupported = false;
+    uint64_t _tileSetVersion = 1;
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> _frameTileSetVersion{};
+    std::array<std::optional<uint64_t>, MAX_FRAMES_IN_FLIGHT> _frameCameraVersion{};
+
+    // Tile uploads run on the transfer queue, the next frame acquires them and builds their mips.
+    struct UploadBatch {
+        VkCommandBuffer commandBuffer;
+        VkFence fence;
+        uint64_t ringMarker;
+        uint32_t timerSlot; // GpuFrameTimer transfer slot
+        std::vector<std::pair<VkBuffer, Veloxr::MemoryAllocation>> stagingBuffers; // Only tiles bigger than the ring
+    };
+    struct PendingAcquire {
+        VkImage image;
+        uint32_t width, height, mipLevels, layer;
+        bool generateMips; // False for compressed tiles, their levels were uploaded
+    };
+    std::vector<UploadBatch> _uploadsInFlight;
+    std::vector<std::pair<Veloxr::TileKey, Veloxr::TextureData>> _decodedTiles; // Waiting for ring space
+    Veloxr::StagingRing _stagingRing;
+    Veloxr::MemoryAllocator _allocator;
+    uint64_t _stagingRingSize = 128ull * 1024 * 1024;
+    std::vector<PendingAcquire> _pendingAcquires;
+    std::vector<VkSemaphore> _uploadWaitSemaphores;                       // Waited on by the next frame submit
+    std::vector<std::pair<uint64_t, VkSemaphore>> _retiredUploadSemaphores; // Submitted frame count at the wait
+    std::vector<VkSemaphore> _freeUploadSemaphores;
+    std::vector<VkFence> _freeUploadFences;
+    // Headless readbacks copy the finished frame into their own buffer, a pool task waits on the
+    // fence and hands the pixels over. Buffers are freed on the render thread once that task is done.
+    struct OffscreenReadback {
+        VkCommandBuffer commandBuffer;
+        VkFence fence;
+        VkBuffer buffer;
+        Veloxr::MemoryAllocation memory;
+        std::future<void> copied;
+    };
+    std::vector<OffscreenReadback> _readbacksInFlight;
+    // On-demand rendering, what the last drawn frame showed. The redraw flag and callback are above _tileLoads.
+    bool _onDemand = true;
+    bool _animating = false;
+    uint64_t _drawnCameraVersion = 0;
+    uint64_t _drawnTileSetVersion = 0;
+    // Profiling
+    Veloxr::GpuFrameTimer _gpuTimer;
+    Veloxr::FrameStats _frameStats;
+    Veloxr::FrameTimeHistogram _cpuFrameTimes;
+    Veloxr::FrameTimeHistogram _gpuFrameTimes;
     // Sync
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
@@ -323,6 +602,7 @@ private:
         glfwSetMouseButtonCallback(window, mouse_button_callback);
         glfwSetCursorPosCallback(window, cursor_position_callback);
         glfwSetScrollCallback(window, scroll_callback);
+        if (!_redrawCallback) setRedrawCallback([]() { glfwPostEmptyEvent(); });
 
     }
 public:
@@ -331,27 +611,83 @@ public:
         auto now = std::chrono::high_resolution_clock::now();
         auto nowTop = std::chrono::high_resolution_clock::now();
 
-        if(!windowHandle) initGlfw();
+        if(!windowHandle && !_headless) initGlfw();
 
         auto timeElapsed = std::chrono::high_resolution_clock::now() - now;
         std::cout << "Init glfw: " << std::chrono::duration_cast<std::chrono::milliseconds>(timeElapsed).count() << "ms\t" << std::chrono::duration_cast<std::chrono::microseconds>(timeElapsed).count() << "microseconds.\n";
         createVulkanInstance();
         setupDebugMessenger();
-        if(!windowHandle) createSurface();
+        if (_headless) surface = VK_NULL_HANDLE;
+        else if(!windowHandle) createSurface();
         else createSurfaceFromWindowHandle(windowHandle);
 
         _deviceUtils = std::make_unique<Veloxr::Device>(instance, surface, enableValidationLayers);
+        _deviceUtils->setPreferSoftwareDevice(_softwareRendering);
         _deviceUtils->create();
+        initDeviceResources();
+    }
+
+    // Renders with a host's device instead of creating an instance, surface and swapchain, e.g. the
+    // one Qt Quick's RHI runs on. Frames go to an image the host samples, see recordExternalFrame().
+    // The host keeps owning the instance, device and queue; setWindowDimensions() sizes the image.
+    void initExternal(VkInstance externalInstance, const Veloxr::ExternalDevice& external) {
+        _external = true;
+        instance = externalInstance;
+        surface = VK_NULL_HANDLE;
+        enableValidationLayers = false; // The host decided on layers, and may not have debug utils
+        _deviceUtils = std::make_unique<Veloxr::Device>(instance, surface, false);
+        _deviceUtils->adopt(external);
+        initDeviceResources();
+    }
+
+private:
+    void initDeviceResources() {
+        auto now = std::chrono::high_resolution_clock::now();
+        auto timeElapsed = std::chrono::high_resolution_clock::now() - now;
         device = _deviceUtils->getLogicalDevice();
         physicalDevice = _deviceUtils->getPhysicalDevice();
         graphicsQueue = _deviceUtils->getGraphicsQueue();
         presentQueue = _deviceUtils->getPresentationQueue();
+        transferQueue = _deviceUtils->getTransferQueue();
+        Veloxr::QueueFamilyIndices queueFamilies = _deviceUtils->getQueueFamilies();
+        graphicsQueueFamily = queueFamilies.graphicsFamily.value();
+        transferQueueFamily = queueFamilies.transferFamily.value();
+        dedicatedTransfer = queueFamilies.hasDedicatedTransfer();
+        _allocator.init(device, physicalDevice);
         createCommandPool();
+        _stagingRing.init(device, physicalDevice, _allocator, _stagingRingSize);
+        _gpuTimer.init(device, physicalDevice, graphicsQueueFamily, transferQueueFamily, MAX_FRAMES_IN_FLIGHT);
+
+        // Mip chains are built with linear blits, without support tiles stay single level.
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
+        _linearBlitSupported = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) &&
+            (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT) &&
+            (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+        if (!_linearBlitSupported) {
+            std::cerr << "VK_FORMAT_R8G8B8A8_SRGB does not support linear blits, tiles will not be mipmapped.\n";
+        }
 
         now = std::chrono::high_resolution_clock::now();
         //addTexture(PREFIX+"/Users/ljuek/Downloads/56000.jpg");
 
-        auto res = createTiledTexture(PREFIX+"/Users/ljuek/Downloads/Colonial.jpg");
+        //auto res = createTiledTexture(PREFIX+"/Users/ljuek/Downloads/Colonial.jpg");
+        _bindless = _deviceUtils->supportsDescriptorIndexing();
+        if (_bindless) {
+            _tileSlotCount = std::min<uint32_t>(MAX_TILE_SLOTS, _deviceUtils->getMaxBindlessTextures());
+        } else {
+            createTileArray(1, 1); // Placeholder so the descriptor is valid before an image is open
+        }
+        _tileSampler = createTextureSampler();
+        std::cout << "[RESIDENCY] " << (_bindless ? "Bindless tile array" : "sampler2DArray fallback") << "\n";
+        _camera.init(1.0f); // Until an image sets its aspect ratio
+        if (!_headless && !_initialImagePath.empty()) { // Headless callers open their own
+            try {
+                openImage(_initialImagePath);
+            } catch (const std::exception& e) {
+                std::cerr << "[RESIDENCY] " << e.what() << ", starting without an image\n";
+            }
+        }
         std::cout << "Texture creation: " << std::chrono::duration_cast<std::chrono::milliseconds>(timeElapsed).count() << "ms\t" << std::chrono::duration_cast<std::chrono::microseconds>(timeElapsed).count() << "microseconds.\n";
         timeElapsed = std::chrono::high_resolution_clock::now() - now;
         //addTexture(PREFIX+"/Users/ljuek/Downloads/Colonial.jpg");
@@ -363,20 +699,800 @@ public:
         createImageViews();
         createRenderPass();
         createDescriptorLayout();
+        _pipelineCache.init(device, physicalDevice, _pipelineCacheDirectory);
         createGraphicsPipeline();
+        createCullPipeline();
+        _pipelineCache.save();
         createFramebuffers();
         
-        createVertexBuffer();
+        createVertexBuffers();
         createUniformBuffers();
         createDescriptorPool();
         createDescriptorSets();
+        createCullDescriptorSets();
         createCommandBuffer();
+        createFrameCommandBuffers();
         createSyncObjects();
         auto timeElapsedTop = std::chrono::high_resolution_clock::now() - now;
         std::cout << "Init(): " << std::chrono::duration_cast<std::chrono::milliseconds>(timeElapsedTop).count() << "ms\t" << std::chrono::duration_cast<std::chrono::microseconds>(timeElapsedTop).count() << "microseconds.\n";
     }
+
+public:
+    // Only reads the header here, tiles are decoded and uploaded on demand by updateResidency().
+    void openImage(const std::string& input_filepath) {
+        parkOpenImage();
+        _tileCache.close();
+        _compressedCache.close();
+
+        _sourceTexture.init(input_filepath);
+        if (!_sourceTexture.isInitialized()) {
+            throw std::runtime_error("failed to open image: " + input_filepath);
+        }
+        auto resolution = _sourceTexture.getResolution();
+        _camera.init((float)resolution.x / (float)resolution.y);
+
+        _tileFormat = Veloxr::TileFormat::RGBA8;
+        if (_tileCompressionEnabled && _deviceUtils->supportsTextureCompressionBC()) {
+            int channels = _sourceTexture.getNumChannels();
+            _tileFormat = (channels == 2 || channels >= 4) ? Veloxr::TileFormat::BC7 : Veloxr::TileFormat::BC1;
+        }
+        uint32_t bitsPerTexel = _tileFormat == Veloxr::TileFormat::BC1 ? 4 : _tileFormat == Veloxr::TileFormat::BC7 ? 8 : 32;
+
+        uint32_t tileSize = std::min(_streamingTileSize, _deviceUtils->getMaxTextureResolution());
+        bool freshArray = false;
+        if (!_bindless && (_tileArrayExtent != tileSize || _tileArrayFormat != tileVkFormat())) {
+            // Parked tiles are layers of the array, a new one leaves nothing to keep.
+            retireTiles(_texturePool.clear());
+            // Layers are full tiles with a full mip chain, size the array from the pool budget.
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+            uint64_t layerBytes = static_cast<uint64_t>(tileSize) * tileSize * bitsPerTexel / 8 * 4 / 3;
+            uint64_t layers = std::max<uint64_t>(1, texturePoolBudget() / layerBytes);
+            layers = std::min<uint64_t>({layers, properties.limits.maxImageArrayLayers, MAX_TILE_SLOTS});
+            createTileArray(tileSize, static_cast<uint32_t>(layers));
+            freshArray = true;
+        }
+
+        // The open image keeps slots for twice its budget in full tiles (edge tiles are smaller) plus the
+        // preview, the pool may fill the rest.
+        uint64_t fullTileBytes = static_cast<uint64_t>(tileSize) * tileSize * bitsPerTexel / 8 * 4 / 3;
+        uint64_t openImageTiles = std::max<uint64_t>(std::min<uint64_t>(_tileSlotCount / 2, _residencyBudget / fullTileBytes * 2 + 2), std::min<uint32_t>(_tileSlotCount, 2));
+        _texturePoolMaxTiles = _tileSlotCount - static_cast<uint32_t>(openImageTiles);
+
+        std::vector<Veloxr::TexturePool<StreamedTile>::Entry> warm;
+        Veloxr::SourceStamp sourceStamp = Veloxr::SourceStamp::of(input_filepath);
+        bool reusable = _texturePool.take(input_filepath, sourceStamp, _tileFormat, tileSize, warm);
+        trimTexturePool();
+        _nextPoolTrim = submittedFrames + POOL_TRIM_INTERVAL;
+
+        _residency.init(resolution.x, resolution.y, tileSize, _residencyBudget, _tileSlotCount - _texturePool.getTileCount() - 1, _maxLoadsInFlight);
+        _residency.setBitsPerTexel(bitsPerTexel);
+        _openImagePath = input_filepath;
+        _openImageSource = sourceStamp;
+
+        // Tiles parked from the last visit are resident again straight away, coarsest first so the
+        // whole image shows even if the budget shrank since.
+        std::sort(warm.begin(), warm.end(), [](const auto& l, const auto& r) { return l.key.level > r.key.level; });
+        size_t restored = 0;
+        for (auto& entry : warm) {
+            if (reusable && _residency.adoptResident(entry.key)) {
+                _residentTiles[entry.key] = entry.tile;
+                restored++;
+            } else {
+                retireTiles({entry.tile});
+            }
+        }
+        if (!warm.empty()) {
+            std::cout << "[POOL] Restored " << restored << " of " << warm.size() << " tiles of " << input_filepath << "\n";
+        }
+
+        // Cached tiles skip the decode entirely. An RGBA8 cache is filled in the background on the first open,
+        // compressed tiles are only cached in their own format, as they are encoded. An RGBA8 pyramid next to
+        // them would cost 4 bytes per pixel on disk for tiles that are never read again.
+        if (_tileCacheEnabled && _tileFormat == Veloxr::TileFormat::RGBA8) {
+            if (_tileCache.open(input_filepath, resolution.x, resolution.y, tileSize, _residency.getLevelCount(), _tileCacheDirectory)) {
+                _tileCache.buildAsync(_sourceTexture);
+            }
+        } else if (_tileCacheEnabled) {
+            _compressedCache.open(input_filepath, resolution.x, resolution.y, tileSize, _residency.getLevelCount(), _tileCacheDirectory, _tileFormat);
+        }
+        // A cached fallback tile is already instant, otherwise show something rough while it decodes.
+        Veloxr::TileKey fallback = _residency.getFallbackTile();
+        if (_progressiveOpen && !_residentTiles.count(fallback) && !_tileCache.hasTile(fallback) && !_compressedCache.hasTile(fallback)) {
+            Veloxr::OIIOTexture source = _sourceTexture;
+            Veloxr::TileFormat format = _tileFormat;
+            uint32_t previewSize = std::min(tileSize, MAX_PREVIEW_SIZE);
+            // Not async(): the redraw has to be requested after the future is ready, or the frame could miss it.
+            auto promise = std::make_shared<std::promise<Veloxr::TextureData>>();
+            _previewLoad = promise->get_future();
+            std::atomic<bool>* redrawRequested = &_redrawRequested;
+            std::function<void()> notify = _redrawCallback;
+            _previewLoads.run([source, format, previewSize, promise, redrawRequested, notify]() {
+                try {
+                    Veloxr::TextureTiling tiler{};
+                    Veloxr::TextureData preview = tiler.loadPreview(source, previewSize);
+                    if (format != Veloxr::TileFormat::RGBA8 && preview.width != 0 && preview.height != 0) {
+                        preview = Veloxr::BlockCompression::compressTile(preview, format);
+                    }
+                    promise->set_value(std::move(preview));
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+                redrawRequested->store(true, std::memory_order_release);
+                if (notify) notify();
+            });
+        }
+        std::cout << "[RESIDENCY] Tile format " << (_tileFormat == Veloxr::TileFormat::BC1 ? "BC1" : _tileFormat == Veloxr::TileFormat::BC7 ? "BC7" : "RGBA8") << "\n";
+
+        // A fresh texture array has no readers yet, other slots stay retired until their frames finish.
+        // Parked and restored tiles keep theirs.
+        if (freshArray) _retiredTileSlots.clear();
+        std::vector<bool> taken(_tileSlotCount, false);
+        for (auto& [frame, slot] : _retiredTileSlots) taken[slot] = true;
+        _texturePool.forEachTile([&taken](const StreamedTile& tile) { taken[tile.slot] = true; });
+        for (auto& [key, tile] : _residentTiles) taken[tile.slot] = true;
+        _freeTileSlots.clear();
+        for (uint32_t slot = _tileSlotCount; slot > 0; slot--) {
+            if (!taken[slot - 1]) _freeTileSlots.push_back(slot - 1);
+        }
+        _tileSetVersion++;
+    }
 private:
 
+    // Moves the open image's resident tiles into the pool rather than releasing them.
+    void parkOpenImage() {
+        std::vector<Veloxr::TexturePool<StreamedTile>::Entry> parked;
+        for (auto& [key, tile] : _residentTiles) {
+            parked.push_back({key, tile, _residency.tileBytes(key), _residency.getLastUsed(key)});
+        }
+        _residentTiles.clear();
+        releaseStreamedTiles(false); // Loads in flight, decoded tiles and the preview
+        if (!_openImagePath.empty()) {
+            _texturePool.park(_openImagePath, _openImageSource, _tileFormat, _residency.getTileSize(), std::move(parked));
+        } else {
+            for (auto& entry : parked) retireTiles({entry.tile});
+        }
+        _openImagePath.clear();
+    }
+
+    // Everything tiles may use, the open image's residency budget included.
+    uint64_t texturePoolBudget() const {
+        uint64_t budget = _texturePoolBudget ? _texturePoolBudget : 4 * _residencyBudget;
+        VkDeviceSize heapBudget = 0, heapUsage = 0;
+        if (_deviceUtils->getDeviceLocalBudget(heapBudget, heapUsage)) {
+            // Usage includes our own tiles, they may have whatever the budget leaves beside everyone else's.
+            uint64_t openTiles = _openImagePath.empty() ? 0 : _residency.getResidentBytes();
+            uint64_t tiles = _bindless ? _texturePool.getBytes() + openTiles : _tileArray.textureImageMemory.size;
+            uint64_t others = heapUsage > tiles ? heapUsage - tiles : 0;
+            uint64_t available = heapBudget > others ? (heapBudget - others) / 10 * 9 : 0;
+            budget = std::min<uint64_t>(budget, available);
+        }
+        return std::max(budget, _residencyBudget);
+    }
+
+    // Keeps parked tiles within what the pool budget leaves beside the open image.
+    void trimTexturePool() {
+        if (_texturePool.getTileCount() == 0) return;
+        uint64_t budget = texturePoolBudget();
+        std::vector<StreamedTile> evicted = _texturePool.trim(budget - _residencyBudget, _texturePoolMaxTiles);
+        if (evicted.empty()) return;
+        std::cout << "[POOL] Evicted " << evicted.size() << " parked tiles, " << _texturePool.getImageCount() << " images / "
+                  << (_texturePool.getBytes() / 1024.0 / 1024.0) << " MB still warm\n";
+        retireTiles(evicted);
+    }
+
+    void retireTiles(const std::vector<StreamedTile>& tiles) {
+        for (const StreamedTile& tile : tiles) {
+            _retiredTextures.push_back({submittedFrames, tile.texture});
+            _retiredTileSlots.push_back({submittedFrames, tile.slot});
+        }
+    }
+
+    uint32_t tileMipLevels(uint32_t width, uint32_t height) const {
+        if (_tileFormat != Veloxr::TileFormat::RGBA8) return Veloxr::BlockCompression::fullMipChain(width, height);
+        if (!_linearBlitSupported) return 1;
+        return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+    }
+
+    VkVirtualTexture createTileTexture(const Veloxr::TextureData& tile) {
+        return createTileTextures({&tile}).front();
+    }
+
+    // Uploads every tile and builds its mip chain in a single command buffer, one submit and one wait per batch.
+    std::vector<VkVirtualTexture> createTileTextures(const std::vector<const Veloxr::TextureData*>& tiles) {
+        std::vector<VkVirtualTexture> textures(tiles.size());
+        std::vector<std::pair<VkBuffer, Veloxr::MemoryAllocation>> stagingBuffers;
+        if (tiles.empty()) return textures;
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        for (size_t i = 0; i < tiles.size(); i++) {
+            const Veloxr::TextureData& tile = *tiles[i];
+            uint32_t mipLevels = tileMipLevels(tile.width, tile.height);
+            textures[i] = allocateTileTexture(tile.width, tile.height, mipLevels);
+            stagingBuffers.push_back(stageTile(tile));
+            recordTileCopy(commandBuffer, stagingBuffers.back().first, 0, textures[i].textureImage, tile, mipLevels);
+            recordTileFinish(commandBuffer, textures[i].textureImage, tile.width, tile.height, mipLevels, tile.format == Veloxr::TileFormat::RGBA8);
+        }
+        endSingleTimeCommands(commandBuffer);
+
+        for (auto& [buffer, memory] : stagingBuffers) {
+            vkDestroyBuffer(device, buffer, nullptr);
+            _allocator.free(memory);
+        }
+        return textures;
+    }
+
+    // Records the copies on the transfer queue and returns straight away. The images are usable
+    // once the next frame has run the matching recordPendingAcquires().
+    // Uploads tiles in order until the staging ring is full and returns how many went out.
+    size_t submitTileUploads(const std::vector<const Veloxr::TextureData*>& tiles, const std::vector<uint32_t>& slots, std::vector<VkVirtualTexture>& textures) {
+        textures.clear();
+        if (tiles.empty()) return 0;
+
+        UploadBatch batch{};
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = transferCommandPool;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+        batch.timerSlot = _gpuTimer.recordTransferBegin(batch.commandBuffer);
+
+        for (size_t i = 0; i < tiles.size(); i++) {
+            const Veloxr::TextureData& tile = *tiles[i];
+            VkDeviceSize imageSize = static_cast<VkDeviceSize>(tile.pixelData.size());
+
+            VkBuffer source;
+            VkDeviceSize offset = 0;
+            if (_stagingRing.allocate(imageSize, offset)) {
+                memcpy(_stagingRing.getMapped() + offset, tile.pixelData.data(), static_cast<size_t>(imageSize));
+                source = _stagingRing.getBuffer();
+            } else if (imageSize > _stagingRing.getCapacity()) {
+                batch.stagingBuffers.push_back(stageTile(tile));
+                source = batch.stagingBuffers.back().first;
+            } else {
+                break; // Ring is full, the rest goes out once earlier batches retire
+            }
+
+            uint32_t mipLevels;
+            uint32_t layer = 0;
+            if (_bindless) {
+                mipLevels = tileMipLevels(tile.width, tile.height);
+                textures.push_back(allocateTileTexture(tile.width, tile.height, mipLevels));
+            } else {
+                mipLevels = _tileArrayMipLevels;
+                layer = slots[i];
+                textures.push_back({});
+            }
+            VkImage image = _bindless ? textures.back().textureImage : _tileArray.textureImage;
+            recordTileCopy(batch.commandBuffer, source, offset, image, tile, mipLevels, layer, _bindless ? 0 : _tileArrayExtent);
+            if (dedicatedTransfer) {
+                recordOwnershipTransfer(batch.commandBuffer, image, mipLevels, true, layer);
+            }
+            _pendingAcquires.push_back({image, tile.width, tile.height, mipLevels, layer, tile.format == Veloxr::TileFormat::RGBA8});
+        }
+        batch.ringMarker = _stagingRing.marker();
+        _gpuTimer.recordTransferEnd(batch.commandBuffer, batch.timerSlot);
+
+        if (textures.empty()) {
+            vkEndCommandBuffer(batch.commandBuffer);
+            vkFreeCommandBuffers(device, transferCommandPool, 1, &batch.commandBuffer);
+            _gpuTimer.finishTransfer(batch.timerSlot);
+            return 0;
+        }
+
+        if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
+
+        // External frames are submitted by the host, nothing could wait on a semaphore. The copies
+        // share its queue and land ahead of the frame, whose acquire barriers order against them.
+        VkSemaphore semaphore = _external ? VK_NULL_HANDLE : acquireUploadSemaphore();
+        batch.fence = acquireUploadFence();
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.commandBuffer;
+        submitInfo.signalSemaphoreCount = _external ? 0 : 1;
+        submitInfo.pSignalSemaphores = &semaphore;
+        if (vkQueueSubmit(transferQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit tile uploads!");
+        }
+
+        if (!_external) _uploadWaitSemaphores.push_back(semaphore);
+        _uploadsInFlight.push_back(std::move(batch));
+        return textures.size();
+    }
+
+    // Graphics side of the upload, recorded ahead of the render pass of the frame that waits on the upload semaphores.
+    void recordPendingAcquires(VkCommandBuffer commandBuffer) {
+        for (const PendingAcquire& pending : _pendingAcquires) {
+            if (dedicatedTransfer) {
+                recordOwnershipTransfer(commandBuffer, pending.image, pending.mipLevels, false, pending.layer);
+            }
+            recordTileFinish(commandBuffer, pending.image, pending.width, pending.height, pending.mipLevels, pending.generateMips, pending.layer);
+        }
+        _pendingAcquires.clear();
+    }
+
+    // RGBA8 tiles build their mips with blits, compressed tiles already have every level and only change layout.
+    void recordTileFinish(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, bool generateMips, uint32_t layer = 0) {
+        if (generateMips) {
+            recordMipmapGeneration(commandBuffer, image, width, height, mipLevels, layer);
+        } else {
+            recordLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, mipLevels, layer);
+        }
+    }
+
+    // Frees staging memory of batches the transfer queue has finished with, oldest first so the ring stays FIFO.
+    void collectFinishedUploads() {
+        size_t finished = 0;
+        while (finished < _uploadsInFlight.size() && vkGetFenceStatus(device, _uploadsInFlight[finished].fence) == VK_SUCCESS) {
+            _stagingRing.release(_uploadsInFlight[finished].ringMarker);
+            releaseUploadBatch(_uploadsInFlight[finished]);
+            finished++;
+        }
+        _uploadsInFlight.erase(_uploadsInFlight.begin(), _uploadsInFlight.begin() + finished);
+
+        for (auto it = _retiredUploadSemaphores.begin(); it != _retiredUploadSemaphores.end();) {
+            if (submittedFrames >= it->first + MAX_FRAMES_IN_FLIGHT) {
+                _freeUploadSemaphores.push_back(it->second);
+                it = _retiredUploadSemaphores.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void releaseUploadBatch(UploadBatch& batch) {
+        _gpuTimer.finishTransfer(batch.timerSlot);
+        for (auto& [buffer, memory] : batch.stagingBuffers) {
+            vkDestroyBuffer(device, buffer, nullptr);
+            _allocator.free(memory);
+        }
+        batch.stagingBuffers.clear();
+        vkFreeCommandBuffers(device, transferCommandPool, 1, &batch.commandBuffer);
+        vkResetFences(device, 1, &batch.fence);
+        _freeUploadFences.push_back(batch.fence);
+    }
+
+    VkSemaphore acquireUploadSemaphore() {
+        if (!_freeUploadSemaphores.empty()) {
+            VkSemaphore semaphore = _freeUploadSemaphores.back();
+            _freeUploadSemaphores.pop_back();
+            return semaphore;
+        }
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        VkSemaphore semaphore;
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload semaphore!");
+        }
+        return semaphore;
+    }
+
+    VkFence acquireUploadFence() {
+        if (!_freeUploadFences.empty()) {
+            VkFence fence = _freeUploadFences.back();
+            _freeUploadFences.pop_back();
+            return fence;
+        }
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VkFence fence;
+        if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload fence!");
+        }
+        return fence;
+    }
+
+    void destroyUploadResources() {
+        for (UploadBatch& batch : _uploadsInFlight) {
+            vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            releaseUploadBatch(batch);
+        }
+        _uploadsInFlight.clear();
+        _pendingAcquires.clear();
+
+        for (VkSemaphore semaphore : _uploadWaitSemaphores) vkDestroySemaphore(device, semaphore, nullptr);
+        for (auto& [frame, semaphore] : _retiredUploadSemaphores) vkDestroySemaphore(device, semaphore, nullptr);
+        for (VkSemaphore semaphore : _freeUploadSemaphores) vkDestroySemaphore(device, semaphore, nullptr);
+        for (VkFence fence : _freeUploadFences) vkDestroyFence(device, fence, nullptr);
+        _uploadWaitSemaphores.clear();
+        _retiredUploadSemaphores.clear();
+        _freeUploadSemaphores.clear();
+        _freeUploadFences.clear();
+        _stagingRing.destroy();
+    }
+
+    VkFormat tileVkFormat() const {
+        switch (_tileFormat) {
+            case Veloxr::TileFormat::BC1: return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+            case Veloxr::TileFormat::BC7: return VK_FORMAT_BC7_SRGB_BLOCK;
+            default: return VK_FORMAT_R8G8B8A8_SRGB;
+        }
+    }
+
+    VkVirtualTexture allocateTileTexture(uint32_t width, uint32_t height, uint32_t mipLevels) {
+        VkVirtualTexture texture{};
+        createImage(width, height, mipLevels, tileVkFormat(), VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.textureImage, texture.textureImageMemory);
+        texture.textureImageView = createImageView(texture.textureImage, tileVkFormat(), mipLevels);
+        texture.textureSampler = VK_NULL_HANDLE; // Tiles sample through _tileSampler
+        return texture;
+    }
+
+    // Fallback for devices without descriptor indexing, every layer starts out readable so the view is always valid.
+    void createTileArray(uint32_t extent, uint32_t layers) {
+        if (_tileArray.textureImage != VK_NULL_HANDLE) {
+            _retiredTextures.push_back({submittedFrames, _tileArray});
+        }
+        _tileArray = {};
+        _tileArrayFormat = tileVkFormat();
+        _tileArrayExtent = extent;
+        _tileArrayMipLevels = tileMipLevels(extent, extent);
+        _tileSlotCount = layers;
+
+        createImage(extent, extent, _tileArrayMipLevels, tileVkFormat(), VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _tileArray.textureImage, _tileArray.textureImageMemory, layers);
+        _tileArray.textureImageView = createImageView(_tileArray.textureImage, tileVkFormat(), _tileArrayMipLevels, VK_IMAGE_VIEW_TYPE_2D_ARRAY, layers);
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        recordLayoutTransition(commandBuffer, _tileArray.textureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, _tileArrayMipLevels, 0, layers);
+        endSingleTimeCommands(commandBuffer);
+        std::cout << "[RESIDENCY] Tile array of " << layers << " x " << extent << "px layers\n";
+    }
+
+    // Safe while frames are in flight, the slot was retired until no pending frame could read it.
+    void writeTileDescriptor(uint32_t slot, VkImageView view) {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = view;
+
+        std::array<VkWriteDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptorWrites{};
+        for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+            descriptorWrites[frame].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[frame].dstSet = descriptorSets[frame];
+            descriptorWrites[frame].dstBinding = 1;
+            descriptorWrites[frame].dstArrayElement = slot;
+            descriptorWrites[frame].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            descriptorWrites[frame].descriptorCount = 1;
+            descriptorWrites[frame].pImageInfo = &imageInfo;
+        }
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    std::pair<VkBuffer, Veloxr::MemoryAllocation> stageTile(const Veloxr::TextureData& tile) {
+        VkDeviceSize imageSize = static_cast<VkDeviceSize>(tile.pixelData.size());
+
+        VkBuffer stagingBuffer;
+        Veloxr::MemoryAllocation stagingBufferMemory;
+        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+        memcpy(stagingBufferMemory.mapped, tile.pixelData.data(), static_cast<size_t>(imageSize));
+        return {stagingBuffer, stagingBufferMemory};
+    }
+
+    // Leaves every level in TRANSFER_DST with level 0 written, or every level the tile carries for compressed tiles.
+    // imageExtent is the square array layer size, 0 when the image is exactly tile sized.
+    void recordTileCopy(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, VkDeviceSize stagingOffset, VkImage image, const Veloxr::TextureData& tile, uint32_t mipLevels, uint32_t layer = 0, uint32_t imageExtent = 0) {
+        recordLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, mipLevels, layer);
+        if (tile.format == Veloxr::TileFormat::RGBA8) {
+            recordCopyBufferToImage(commandBuffer, stagingBuffer, image, tile.width, tile.height, stagingOffset, layer);
+            return;
+        }
+
+        // Copy extents must cover whole blocks unless they end on the image edge, the packed data is block padded already.
+        for (uint32_t level = 0; level < std::min(tile.mipLevels, mipLevels); level++) {
+            uint32_t width = std::max(1u, tile.width >> level);
+            uint32_t height = std::max(1u, tile.height >> level);
+            uint32_t levelWidth = imageExtent ? std::max(1u, imageExtent >> level) : width;
+            uint32_t levelHeight = imageExtent ? std::max(1u, imageExtent >> level) : height;
+            VkDeviceSize offset = stagingOffset + Veloxr::BlockCompression::levelOffset(tile.format, tile.width, tile.height, level);
+            recordCopyBufferToImage(commandBuffer, stagingBuffer, image, std::min((width + 3) & ~3u, levelWidth), std::min((height + 3) & ~3u, levelHeight), offset, layer, level);
+        }
+    }
+
+    // Queue family ownership transfer from the transfer to the graphics family, the layout stays TRANSFER_DST.
+    // The release half goes in the transfer submit, the acquire half in the graphics submit that waits on it.
+    void recordOwnershipTransfer(VkCommandBuffer commandBuffer, VkImage image, uint32_t mipLevels, bool release, uint32_t layer = 0) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = transferQueueFamily;
+        barrier.dstQueueFamilyIndex = graphicsQueueFamily;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.baseArrayLayer = layer;
+        barrier.subresourceRange.layerCount = 1;
+
+        VkPipelineStageFlags sourceStage;
+        VkPipelineStageFlags destinationStage;
+        if (release) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            destinationStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        } else {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // Expects every level in TRANSFER_DST with level 0 written, leaves every level in SHADER_READ_ONLY.
+    // Array layers may hold a smaller edge tile in their top-left corner, only that part is filtered down.
+    void recordMipmapGeneration(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layer = 0) {
+        int32_t mipWidth = static_cast<int32_t>(width);
+        int32_t mipHeight = static_cast<int32_t>(height);
+
+        for (uint32_t level = 1; level < mipLevels; level++) {
+            recordLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, level - 1, 1, layer);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.baseArrayLayer = layer;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.baseArrayLayer = layer;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(commandBuffer,
+                    image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1, &blit,
+                    VK_FILTER_LINEAR);
+
+            recordLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, level - 1, 1, layer);
+
+            if (mipWidth > 1) mipWidth /= 2;
+            if (mipHeight > 1) mipHeight /= 2;
+        }
+
+        // The last level was only ever written to.
+        recordLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels - 1, 1, layer);
+    }
+
+    // Called after the frame's fence, uploads finished decodes, evicts and kicks off new loads.
+    void updateResidency() {
+        collectFinishedUploads();
+        if (!_residency.isInitialized()) return;
+
+        // Other applications can take memory away at any time, give parked tiles back when they do.
+        if (submittedFrames >= _nextPoolTrim) {
+            _nextPoolTrim = submittedFrames + POOL_TRIM_INTERVAL;
+            trimTexturePool();
+        }
+
+        for (auto it = _retiredTextures.begin(); it != _retiredTextures.end();) {
+            if (submittedFrames >= it->first + MAX_FRAMES_IN_FLIGHT) {
+                it->second.destroy(device, _allocator);
+                it = _retiredTextures.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = _retiredTileSlots.begin(); it != _retiredTileSlots.end();) {
+            if (submittedFrames >= it->first + MAX_FRAMES_IN_FLIGHT) {
+                _freeTileSlots.push_back(it->second);
+                it = _retiredTileSlots.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        DecodedTile decoded;
+        while (_decodedQueue.tryPop(decoded)) {
+            if (decoded.second.width == 0 || decoded.second.height == 0) {
+                _residency.markFailed(decoded.first);
+            } else {
+                _decodedTiles.push_back(std::move(decoded));
+            }
+        }
+
+        updatePreview();
+
+        // Everything that fits in the staging ring goes out in one batch, the rest waits a frame.
+        std::vector<const Veloxr::TextureData*> uploads;
+        std::vector<uint32_t> slots;
+        for (size_t i = 0; i < _decodedTiles.size() && i < _freeTileSlots.size(); i++) {
+            uploads.push_back(&_decodedTiles[i].second);
+            slots.push_back(_freeTileSlots[_freeTileSlots.size() - 1 - i]);
+        }
+        std::vector<VkVirtualTexture> textures;
+        size_t uploaded = submitTileUploads(uploads, slots, textures);
+        for (size_t i = 0; i < uploaded; i++) {
+            StreamedTile streamed{};
+            streamed.texture = textures[i];
+            streamed.slot = slots[i];
+            streamed.width = _decodedTiles[i].second.width;
+            streamed.height = _decodedTiles[i].second.height;
+            _freeTileSlots.pop_back();
+            if (_bindless) writeTileDescriptor(streamed.slot, streamed.texture.textureImageView);
+            _residentTiles[_decodedTiles[i].first] = streamed;
+            _residency.markLoaded(_decodedTiles[i].first);
+            _tileSetVersion++;
+        }
+        _decodedTiles.erase(_decodedTiles.begin(), _decodedTiles.begin() + uploaded);
+
+        auto update = _residency.update(_camera.getViewProjectionMatrix(), swapChainExtent.width, swapChainExtent.height);
+        for (const auto& key : update.toEvict) {
+            auto it = _residentTiles.find(key);
+            if (it == _residentTiles.end()) continue;
+            _retiredTileSlots.push_back({submittedFrames, it->second.slot});
+            _retiredTextures.push_back({submittedFrames, it->second.texture});
+            _residentTiles.erase(it);
+            _tileSetVersion++;
+        }
+        for (const auto& key : update.toLoad) {
+            Veloxr::TileRegion region = _residency.region(key);
+            Veloxr::OIIOTexture source = _sourceTexture;
+            Veloxr::TileCache* cache = &_tileCache;
+            Veloxr::TileCache* compressedCache = &_compressedCache;
+            Veloxr::TileFormat format = _tileFormat;
+            Veloxr::BoundedQueue<DecodedTile>* queue = &_decodedQueue;
+            std::atomic<bool>* redrawRequested = &_redrawRequested;
+            std::function<void()> notify = _redrawCallback;
+            _tileLoads.run([source, cache, compressedCache, format, key, region, queue, redrawRequested, notify]() {
+                auto load = [&]() {
+                    if (format != Veloxr::TileFormat::RGBA8 && compressedCache->hasTile(key)) {
+                        return compressedCache->readTile(key);
+                    }
+                    Veloxr::TextureData tile;
+                    if (cache->hasTile(key)) {
+                        tile = cache->readTile(key);
+                    } else {
+                        Veloxr::TextureTiling tiler{};
+                        tile = tiler.loadRegion(source, key.level, region.x0, region.y0, region.x1, region.y1);
+                    }
+                    if (format == Veloxr::TileFormat::RGBA8 || tile.width == 0 || tile.height == 0) return tile;
+
+                    Veloxr::TextureData compressed = Veloxr::BlockCompression::compressTile(tile, format);
+                    compressedCache->writeTile(key, compressed);
+                    return compressed;
+                };
+
+                // An empty tile still goes through so the residency stops waiting for it.
+                DecodedTile decoded{key, {}};
+                try {
+                    decoded.second = load();
+                } catch (const std::exception& e) {
+                    std::cerr << "Tile load threw: " << e.what() << std::endl;
+                }
+                while (!queue->tryPush(std::move(decoded))) std::this_thread::yield();
+                redrawRequested->store(true, std::memory_order_release);
+                if (notify) notify();
+            });
+        }
+    }
+
+    // Uploads the preview once it is decoded and retires it as soon as the fallback tile is resident.
+    void updatePreview() {
+        if (_previewLoad.valid() && _previewLoad.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            try {
+                _previewData = _previewLoad.get();
+            } catch (const std::exception& e) {
+                std::cerr << "Preview load threw: " << e.what() << std::endl;
+            }
+        }
+
+        if (_residentTiles.count(_residency.getFallbackTile())) {
+            _previewData = {};
+            retirePreview();
+            return;
+        }
+        if (_previewData.width == 0 || _previewData.height == 0 || _freeTileSlots.empty()) return;
+
+        std::vector<VkVirtualTexture> textures;
+        uint32_t slot = _freeTileSlots.back();
+        if (submitTileUploads({&_previewData}, {slot}, textures) == 0) return;
+        _freeTileSlots.pop_back();
+
+        StreamedTile preview{};
+        preview.texture = textures[0];
+        preview.slot = slot;
+        preview.width = _previewData.width;
+        preview.height = _previewData.height;
+        if (_bindless) writeTileDescriptor(preview.slot, preview.texture.textureImageView);
+        _previewTile = preview;
+        _previewData = {};
+        _tileSetVersion++;
+        std::cout << "[RESIDENCY] Preview " << preview.width << "x" << preview.height << " resident\n";
+    }
+
+    void retirePreview() {
+        if (!_previewTile) return;
+        _retiredTileSlots.push_back({submittedFrames, _previewTile->slot});
+        _retiredTextures.push_back({submittedFrames, _previewTile->texture});
+        _previewTile.reset();
+        _tileSetVersion++;
+    }
+
+    // Rebuild this frame's instances from the resident tiles. Tile descriptors are not touched, only the shared sampler.
+    void refreshFrameTileSet(uint32_t frame) {
+        _tileInstances.clear();
+        _tileLayerStarts.clear();
+        // The preview spans the same rect as the fallback tile and goes underneath everything.
+        std::vector<std::pair<Veloxr::TileRegion, const StreamedTile*>> quads;
+        if (_previewTile) {
+            _tileLayerStarts.push_back(0);
+            quads.push_back({_residency.region(_residency.getFallbackTile()), &*_previewTile});
+        }
+        // The draw list runs from coarse to fine, every level becomes its own layer
+        uint32_t layerLevel = UINT32_MAX;
+        for (const Veloxr::TileKey& key : _residency.drawList()) {
+            auto it = _residentTiles.find(key);
+            if (it == _residentTiles.end()) continue;
+            if (key.level != layerLevel) {
+                _tileLayerStarts.push_back(static_cast<uint32_t>(quads.size()));
+                layerLevel = key.level;
+            }
+            quads.push_back({_residency.region(key), &it->second});
+        }
+
+        for (const auto& [r, tilePointer] : quads) {
+            const StreamedTile& tile = *tilePointer;
+            // Array layers are tile sized, edge tiles only cover the top left of theirs.
+            float u = 1.0f, v = 1.0f;
+            if (!_bindless) {
+                float extent = (float)_tileArrayExtent;
+                u = tile.width / extent;
+                v = tile.height / extent;
+            }
+            _tileInstances.push_back({{r.left, r.top, r.right, r.bottom}, {0.0f, 0.0f, u, v}, (int)tile.slot});
+        }
+        writeFrameInstances(frame);
+
+        updateDescriptorSet(frame);
+        _frameTileSetVersion[frame] = _tileSetVersion;
+    }
+
+    void releaseStreamedTiles(bool immediate) {
+        _tileLoads.wait();
+        _previewLoads.wait();
+        _previewLoad = {};
+        _previewData = {};
+        if (_previewTile && immediate) {
+            _previewTile->texture.destroy(device, _allocator);
+            _previewTile.reset();
+        }
+        retirePreview();
+        DecodedTile decoded;
+        while (_decodedQueue.tryPop(decoded)) {}
+        _decodedTiles.clear();
+
+        for (auto& [key, tile] : _residentTiles) {
+            if (immediate) tile.texture.destroy(device, _allocator);
+            else _retiredTextures.push_back({submittedFrames, tile.texture});
+            if (!immediate) _retiredTileSlots.push_back({submittedFrames, tile.slot});
+        }
+        _residentTiles.clear();
+
+        if (immediate) {
+            for (auto& [frame, texture] : _retiredTextures) texture.destroy(device, _allocator);
+            _retiredTextures.clear();
+        }
+        _tileSetVersion++;
+    }
+
     void addTexture(std::string input_filepath) {
         _textureMap[input_filepath] = {};
         const auto& [textureImage, textureImageMemory, textureHelper] = createTextureImage(input_filepath);
@@ -390,22 +1506,23 @@ private:
         _textureMap[input_filepath].textureData = textureHelper;
     }
 
-    VkSampler createTextureSampler(std::string input_filepath="") {
+    VkSampler createTextureSampler() {
 
         VkSampler textureSampler;
         VkSamplerCreateInfo samplerInfo{};
         samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-        // TODO: See if Linear is better for filter
-        samplerInfo.magFilter = VK_FILTER_NEAREST;
-        samplerInfo.minFilter = VK_FILTER_NEAREST;
-        // TODO: SEe how to repeat, I think clamp
-        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
-        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
-        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
-
-        // TODO: Test with/without this.
-        samplerInfo.anisotropyEnable = VK_FALSE;
-        samplerInfo.maxAnisotropy = 1.0f;
+        bool filtered = _samplerMode != SamplerMode::Nearest;
+        samplerInfo.magFilter = filtered ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        samplerInfo.minFilter = filtered ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        // Clamp to edge when filtering, the border colour would bleed into tile seams.
+        VkSamplerAddressMode addressMode = filtered ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+        samplerInfo.addressModeU = addressMode;
+        samplerInfo.addressModeV = addressMode;
+        samplerInfo.addressModeW = addressMode;
+
+        bool anisotropic = _samplerMode == SamplerMode::Anisotropic && _deviceUtils->supportsSamplerAnisotropy();
+        samplerInfo.anisotropyEnable = anisotropic ? VK_TRUE : VK_FALSE;
+        samplerInfo.maxAnisotropy = anisotropic ? _deviceUtils->getMaxSamplerAnisotropy() : 1.0f;
         samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
 
         // false = normalized, true = [0, texWidth], [0, texHeight]
@@ -416,11 +1533,11 @@ private:
         samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
 
 
-        // TODO: Mipmap
-        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        // Nearest stays on the base level, the others use whatever chain the view has.
+        samplerInfo.mipmapMode = filtered ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = 0.0f;
+        samplerInfo.maxLod = filtered ? VK_LOD_CLAMP_NONE : 0.0f;
 
 
         if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
@@ -432,21 +1549,21 @@ private:
     
     }
 
-    VkImageView createTextureImageView(VkImage textureImage) {
-        return createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB);
+    VkImageView createTextureImageView(VkImage textureImage, uint32_t mipLevels = 1) {
+        return createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, mipLevels);
     }
 
-    VkImageView createImageView(VkImage image, VkFormat format) {
+    VkImageView createImageView(VkImage image, VkFormat format, uint32_t mipLevels = 1, VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D, uint32_t layerCount = 1) {
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.image = image;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.viewType = viewType;
         viewInfo.format = format;
         viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.levelCount = mipLevels;
         viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
+        viewInfo.subresourceRange.layerCount = layerCount;
 
         VkImageView imageView;
         if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
@@ -456,9 +1573,13 @@ private:
         return imageView;
     }
 
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
+    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1) {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        recordLayoutTransition(commandBuffer, image, oldLayout, newLayout, 0, mipLevels);
+        endSingleTimeCommands(commandBuffer);
+    }
 
+    void recordLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseLayer = 0, uint32_t layerCount = 1) {
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = oldLayout;
@@ -467,12 +1588,10 @@ private:
         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.image = image;
         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        barrier.srcAccessMask = 0; // TODO
-        barrier.dstAccessMask = 0; // TODO
+        barrier.subresourceRange.baseMipLevel = baseMipLevel;
+        barrier.subresourceRange.levelCount = levelCount;
+        barrier.subresourceRange.baseArrayLayer = baseLayer;
+        barrier.subresourceRange.layerCount = layerCount;
 
         VkPipelineStageFlags sourceStage;
         VkPipelineStageFlags destinationStage;
@@ -487,6 +1606,26 @@ private:
             barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
             barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
+            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+            // Mip generation, the level we just wrote becomes the next blit's source.
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        } else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+            // Freshly created texture array, nothing to wait for.
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
             sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
             destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
         } else {
@@ -502,21 +1641,23 @@ private:
                 0, nullptr,
                 1, &barrier
                 );
-
-        endSingleTimeCommands(commandBuffer);
     }
 
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        recordCopyBufferToImage(commandBuffer, buffer, image, width, height);
+        endSingleTimeCommands(commandBuffer);
+    }
 
+    void recordCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset = 0, uint32_t layer = 0, uint32_t mipLevel = 0) {
         VkBufferImageCopy region{};
-        region.bufferOffset = 0;
+        region.bufferOffset = bufferOffset;
         region.bufferRowLength = 0;
         region.bufferImageHeight = 0;
 
         region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.mipLevel = mipLevel;
+        region.imageSubresource.baseArrayLayer = layer;
         region.imageSubresource.layerCount = 1;
 
         region.imageOffset = {0, 0, 0};
@@ -533,7 +1674,6 @@ private:
                 1,
                 &region
                 );
-        endSingleTimeCommands(commandBuffer);
     }
 
 
@@ -544,7 +1684,7 @@ private:
         Veloxr::TextureTiling tiler{};
         auto maxResolution = _deviceUtils->getMaxTextureResolution();
         std::cout << "Tiling...\n";
-        Veloxr::TiledResult tileData = tiler.tile4(myTexture, maxResolution * maxResolution);
+        Veloxr::TiledResult tileData = tiler.tile5(myTexture, static_cast<uint64_t>(maxResolution) * maxResolution);
         for(int i = 0; i < tileData.tiles.size(); i++){
             VkVirtualTexture tileTexture;
             int texWidth    = tileData.tiles[i].width;
@@ -562,18 +1702,15 @@ private:
 
 
             VkBuffer stagingBuffer;
-            VkDeviceMemory stagingBufferMemory;
+            Veloxr::MemoryAllocation stagingBufferMemory;
             createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
-            void* data;
-            vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
             //memcpy(data, res.begin()->pixelData.data()/*myTexture.load(input_filepath).data()*/, static_cast<size_t>(imageSize));
-            memcpy(data, tileData.tiles[i].pixelData.data()/*myTexture.load(input_filepath).data()*/, static_cast<size_t>(imageSize));
-            vkUnmapMemory(device, stagingBufferMemory);
+            memcpy(stagingBufferMemory.mapped, tileData.tiles[i].pixelData.data()/*myTexture.load(input_filepath).data()*/, static_cast<size_t>(imageSize));
 
             VkImage textureImage;
-            VkDeviceMemory textureImageMemory;
-            createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+            Veloxr::MemoryAllocation textureImageMemory;
+            createImage(texWidth, texHeight, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
 
             transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
             copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
@@ -581,7 +1718,7 @@ private:
 
 
             vkDestroyBuffer(device, stagingBuffer, nullptr);
-            vkFreeMemory(device, stagingBufferMemory, nullptr);
+            _allocator.free(stagingBufferMemory);
             tileTexture.textureImage = textureImage;
             tileTexture.textureImageMemory = textureImageMemory;
             tileTexture.textureData = myTexture;
@@ -594,18 +1731,12 @@ private:
 
             _textureMap[input_filepath + "_tile_" + std::to_string(i)] = tileTexture;
         }
-        vertices = std::vector<Veloxr::Vertex>(tileData.vertices.begin(), tileData.vertices.end());
-        for(Veloxr::Vertex& vertice : vertices) {
-            std::cout << "Vertex pos : " << vertice.pos.x << ", " << vertice.pos.y << "\n";
-            std::cout << "Vertex texCoord: " << vertice.texCoord.x << ", " << vertice.texCoord.y << "\n";
-            std::cout << "Vertex texUnit: " << vertice.textureUnit << "\n";
-        }
 
 
         return {};
     }
 
-    std::tuple<VkImage, VkDeviceMemory, Veloxr::OIIOTexture> createTextureImage(std::string input_filepath="") {
+    std::tuple<VkImage, Veloxr::MemoryAllocation, Veloxr::OIIOTexture> createTextureImage(std::string input_filepath="") {
         //cv::Mat image = cv::imread("C:/Users/ljuek/Downloads/16kmarble.jpeg", cv::IMREAD_UNCHANGED);
         Test t{};
         //t.run2(PREFIX + "/Users/ljuek/Downloads/Colonial.jpg", PREFIX+"/Users/ljuek/Downloads/Colonial_1.jpg");
@@ -616,7 +1747,7 @@ private:
         auto maxResolution = _deviceUtils->getMaxTextureResolution();
         std::cout << "Tiling...\n";
        // auto res = tiler.tile(myTexture, maxResolution * maxResolution);
-        Veloxr::TiledResult tileData = tiler.tile2(myTexture, maxResolution * maxResolution);
+        Veloxr::TiledResult tileData = tiler.tile2(myTexture, static_cast<uint64_t>(maxResolution) * maxResolution);
 //        int texWidth    = myTexture.getResolution().x;
  //       int texHeight   = myTexture.getResolution().y;
   //      int texChannels = 4;//myTexture.getNumChannels();
@@ -643,18 +1774,15 @@ private:
 
 
         VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
+        Veloxr::MemoryAllocation stagingBufferMemory;
         createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
         //memcpy(data, res.begin()->pixelData.data()/*myTexture.load(input_filepath).data()*/, static_cast<size_t>(imageSize));
-        memcpy(data, tileData.tiles.begin()->pixelData.data()/*myTexture.load(input_filepath).data()*/, static_cast<size_t>(imageSize));
-        vkUnmapMemory(device, stagingBufferMemory);
+        memcpy(stagingBufferMemory.mapped, tileData.tiles.begin()->pixelData.data()/*myTexture.load(input_filepath).data()*/, static_cast<size_t>(imageSize));
 
         VkImage textureImage;
-        VkDeviceMemory textureImageMemory;
-        createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+        Veloxr::MemoryAllocation textureImageMemory;
+        createImage(texWidth, texHeight, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
 
         transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
         copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
@@ -662,7 +1790,7 @@ private:
 
 
         vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        _allocator.free(stagingBufferMemory);
         return {textureImage, textureImageMemory, myTexture};
     }
 
@@ -699,15 +1827,16 @@ private:
         vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
     }
 
-    void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Veloxr::MemoryAllocation& imageMemory, uint32_t arrayLayers = 1, VkImageCreateFlags flags = 0) {
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.flags = flags;
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
         imageInfo.extent.width = width;
         imageInfo.extent.height = height;
         imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
-        imageInfo.arrayLayers = 1;
+        imageInfo.mipLevels = mipLevels;
+        imageInfo.arrayLayers = arrayLayers;
         imageInfo.format = format;
         imageInfo.tiling = tiling;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -719,19 +1848,7 @@ private:
             throw std::runtime_error("failed to create image!");
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device, image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-
-        vkBindImageMemory(device, image, imageMemory, 0);
+        imageMemory = _allocator.allocateForImage(image, properties);
     }
 
     void createDescriptorSets() {
@@ -750,48 +1867,77 @@ private:
         }
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = uniformBuffers[i];
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(UniformBufferObject);
-
-            std::vector<VkDescriptorImageInfo> imageInfos;
-            for (auto& [filepath, structure] : _textureMap) {
-                VkDescriptorImageInfo imageInfo{};
-                imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                imageInfo.imageView = structure.textureImageView;
-                imageInfo.sampler = structure.textureSampler;
-                imageInfos.push_back(imageInfo);
-            }
+            updateDescriptorSet(static_cast<uint32_t>(i));
+        }
+    }
 
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    // Uniforms plus the shared sampler, or the whole texture array in fallback mode.
+    // Bindless tile slots are written by writeTileDescriptor() as tiles arrive.
+    void updateDescriptorSet(uint32_t frame) {
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = uniformBuffers[frame];
+        bufferInfo.offset = 0;
+        bufferInfo.range = sizeof(UniformBufferObject);
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = _bindless ? VK_NULL_HANDLE : _tileArray.textureImageView;
+        imageInfo.sampler = _tileSampler;
+
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = descriptorSets[frame];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = descriptorSets[frame];
+        descriptorWrites[1].dstBinding = _bindless ? 2 : 1;
+        descriptorWrites[1].dstArrayElement = 0;
+        descriptorWrites[1].descriptorType = _bindless ? VK_DESCRIPTOR_TYPE_SAMPLER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pImageInfo = &imageInfo;
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
 
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet = descriptorSets[i];
-            descriptorWrites[0].dstBinding = 0;
-            descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1;
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
+    void createDescriptorPool() {
+        std::vector<VkDescriptorPoolSize> poolSizes(2);
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        if (_bindless) {
+            poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            poolSizes[1].descriptorCount = static_cast<uint32_t>(_tileSlotCount * MAX_FRAMES_IN_FLIGHT);
+            poolSizes.push_back({VK_DESCRIPTOR_TYPE_SAMPLER, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)});
+        } else {
+            poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        }
 
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = descriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = static_cast<uint32_t>(imageInfos.size());
-            descriptorWrites[1].pImageInfo = imageInfos.data();
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags = _bindless ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
-            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool!");
         }
+
+
     }
 
-    void createDescriptorPool() {
+    void createCullDescriptorSets() {
         std::array<VkDescriptorPoolSize, 2> poolSizes{};
         poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-        poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(16 * MAX_FRAMES_IN_FLIGHT);//static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * _textureMap.size());// static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSizes[1].descriptorCount = static_cast<uint32_t>(3 * MAX_FRAMES_IN_FLIGHT);
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -799,11 +1945,47 @@ private:
         poolInfo.pPoolSizes = poolSizes.data();
         poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
-        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor pool!");
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &cullDescriptorPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull descriptor pool!");
+        }
+
+        std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, cullDescriptorSetLayout);
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = cullDescriptorPool;
+        allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        allocInfo.pSetLayouts = layouts.data();
+
+        cullDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+        if (vkAllocateDescriptorSets(device, &allocInfo, cullDescriptorSets.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate cull descriptor sets!");
         }
 
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            updateCullDescriptorSet(i);
+        }
+    }
+
+    // Rewritten whenever the frame's instance buffers are reallocated.
+    void updateCullDescriptorSet(uint32_t frame) {
+        std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+        bufferInfos[0] = {uniformBuffers[frame], 0, sizeof(UniformBufferObject)};
+        bufferInfos[1] = {instanceBuffers[frame], 0, VK_WHOLE_SIZE};
+        bufferInfos[2] = {visibleInstanceBuffers[frame], 0, VK_WHOLE_SIZE};
+        bufferInfos[3] = {drawCommandBuffers[frame], 0, VK_WHOLE_SIZE};
+
+        std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
+        for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+            descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[i].dstSet = cullDescriptorSets[frame];
+            descriptorWrites[i].dstBinding = i;
+            descriptorWrites[i].dstArrayElement = 0;
+            descriptorWrites[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[i].descriptorCount = 1;
+            descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+        }
 
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
 
     void createUniformBuffers() {
@@ -816,7 +1998,7 @@ private:
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
 
-            vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+            uniformBuffersMapped[i] = uniformBuffersMemory[i].mapped;
         }
     }
 
@@ -827,16 +2009,36 @@ private:
         uboLayoutBinding.descriptorCount = 1;
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+        // Bindless: texture2D tileTextures[] plus one sampler. Fallback: a single sampler2DArray.
         VkDescriptorSetLayoutBinding samplerLayoutBinding{};
         samplerLayoutBinding.binding = 1;
-        samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        samplerLayoutBinding.descriptorCount = 16;//static_cast<uint32_t>(_textureMap.size());
+        samplerLayoutBinding.descriptorType = _bindless ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        samplerLayoutBinding.descriptorCount = _bindless ? _tileSlotCount : 1;
         samplerLayoutBinding.pImmutableSamplers = nullptr;
         samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+        VkDescriptorSetLayoutBinding sharedSamplerBinding{};
+        sharedSamplerBinding.binding = 2;
+        sharedSamplerBinding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        sharedSamplerBinding.descriptorCount = 1;
+        sharedSamplerBinding.pImmutableSamplers = nullptr;
+        sharedSamplerBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        std::vector<VkDescriptorSetLayoutBinding> bindings = {uboLayoutBinding, samplerLayoutBinding};
+        if (_bindless) bindings.push_back(sharedSamplerBinding);
+
+        // Slots are only ever written while no pending frame reads them, unwritten ones are never drawn.
+        std::vector<VkDescriptorBindingFlags> bindingFlags(bindings.size(), 0);
+        bindingFlags[1] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = _bindless ? &bindingFlagsInfo : nullptr;
+        layoutInfo.flags = _bindless ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0;
         layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
         layoutInfo.pBindings = bindings.data();
 
@@ -846,7 +2048,7 @@ private:
 
     }
 
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Veloxr::MemoryAllocation& bufferMemory) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
@@ -857,19 +2059,7 @@ private:
             throw std::runtime_error("failed to create buffer!");
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate buffer memory!");
-        }
-
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        bufferMemory = _allocator.allocateForBuffer(buffer, properties);
     }
 
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
@@ -883,35 +2073,76 @@ private:
     }
 
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
-        }
-
-        throw std::runtime_error("failed to find suitable memory type!");
+        return _allocator.findMemoryType(typeFilter, properties);
     }
 
-     void createVertexBuffer() {
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
+    void createVertexBuffers() {
+        VkDeviceSize quadSize = sizeof(unitQuad);
         VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t) bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
+        Veloxr::MemoryAllocation stagingBufferMemory;
+        createBuffer(quadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        memcpy(stagingBufferMemory.mapped, unitQuad.data(), (size_t) quadSize);
+        createBuffer(quadSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, quadBuffer, quadBufferMemory);
+        copyBuffer(stagingBuffer, quadBuffer, quadSize);
+        vkDestroyBuffer(device, stagingBuffer, nullptr);
+        _allocator.free(stagingBufferMemory);
+
+        instanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        instanceBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+        instanceBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+        instanceBuffersCapacity.resize(MAX_FRAMES_IN_FLIGHT);
+        visibleInstanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        visibleInstanceBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+        drawCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        drawCommandBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            createFrameInstanceBuffer(i, sizeof(Veloxr::TileInstance) * 256);
+            createBuffer(sizeof(VkDrawIndirectCommand) * MAX_DRAW_LAYERS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawCommandBuffers[i], drawCommandBuffersMemory[i]);
+            _frameInstances[i].clear();
+            _frameLayerStarts[i].clear();
+        }
+    }
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+    // The cull pass reads the host written instances and compacts them into a device local copy of the same size.
+    void createFrameInstanceBuffer(uint32_t frame, VkDeviceSize bufferSize) {
+        createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[frame], instanceBuffersMemory[frame]);
+        instanceBuffersMapped[frame] = instanceBuffersMemory[frame].mapped;
+        instanceBuffersCapacity[frame] = bufferSize;
+        createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibleInstanceBuffers[frame], visibleInstanceBuffersMemory[frame]);
+        if (!cullDescriptorSets.empty()) updateCullDescriptorSet(frame);
+    }
 
-        copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    // Pans and zooms mostly shift the draw list by a few tiles, so only the span between the
+    // first and last instance that changed is written. Growing reallocates and writes everything.
+    void writeFrameInstances(uint32_t frame) {
+        std::vector<Veloxr::TileInstance>& drawn = _frameInstances[frame];
+        VkDeviceSize bufferSize = sizeof(Veloxr::TileInstance) * _tileInstances.size();
+        if (bufferSize > instanceBuffersCapacity[frame]) {
+            vkDestroyBuffer(device, instanceBuffers[frame], nullptr);
+            _allocator.free(instanceBuffersMemory[frame]);
+            vkDestroyBuffer(device, visibleInstanceBuffers[frame], nullptr);
+            _allocator.free(visibleInstanceBuffersMemory[frame]);
+            createFrameInstanceBuffer(frame, std::max(bufferSize, instanceBuffersCapacity[frame] * 2));
+            drawn.clear();
+        }
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        auto same = [](const Veloxr::TileInstance& a, const Veloxr::TileInstance& b) {
+            return a.rect == b.rect && a.uvRect == b.uvRect && a.slot == b.slot;
+        };
+        size_t first = 0;
+        size_t common = std::min(drawn.size(), _tileInstances.size());
+        while (first < common && same(drawn[first], _tileInstances[first])) first++;
+        size_t last = _tileInstances.size();
+        if (drawn.size() == _tileInstances.size()) {
+            while (last > first && same(drawn[last - 1], _tileInstances[last - 1])) last--;
+        }
+        if (last > first) {
+            auto* mapped = static_cast<Veloxr::TileInstance*>(instanceBuffersMapped[frame]);
+            memcpy(mapped + first, _tileInstances.data() + first, sizeof(Veloxr::TileInstance) * (last - first));
+        }
+        drawn = _tileInstances;
+        _frameLayerStarts[frame] = _tileLayerStarts;
     }
 
     void recreateSwapChain() {
@@ -929,6 +2160,7 @@ private:
         createSwapChain();
         createImageViews();
         createFramebuffers();
+        createFrameCommandBuffers();
     }
 
     void cleanupSwapChain() {
@@ -940,6 +2172,12 @@ private:
             vkDestroyImageView(device, swapChainImageViews[i], nullptr);
         }
 
+        if (rendersOffscreen()) {
+            for (VkImage image : swapChainImages) vkDestroyImage(device, image, nullptr);
+            _allocator.free(_offscreenImageMemory);
+            swapChainImages.clear();
+            return;
+        }
         vkDestroySwapchainKHR(device, swapChain, nullptr);
 
     }
@@ -967,59 +2205,128 @@ private:
     }
 
 
+    // Only written when the camera moved since this frame slot last drew.
     void updateUniformBuffers(uint32_t currentImage) {
+        if (_frameCameraVersion[currentImage] == _camera.getVersion()) return;
         UniformBufferObject ubo{};
-        float time = 1;
-        ubo.view = _camera.getViewMatrix();
-        ubo.proj = _camera.getProjectionMatrix();
-        ubo.model = glm::mat4(1.0f);
+        ubo.viewProj = _camera.getViewProjectionMatrix();
         memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+        _frameCameraVersion[currentImage] = _camera.getVersion();
     }
 
 public:
     void drawFrame() {
+        if (_external) {
+            throw std::runtime_error("external frames are recorded with recordExternalFrame()!");
+        }
         std::cout << "Drawing frame with extent: " << swapChainExtent.width << "x" << swapChainExtent.height << std::endl;
+        auto frameStart = std::chrono::steady_clock::now();
+        auto lapStart = frameStart;
+        auto lap = [&lapStart]() {
+            auto now = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(now - lapStart).count();
+            lapStart = now;
+            return ms;
+        };
+        Veloxr::FrameStats stats = _frameStats;
+
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        stats.cpuWaitMs = lap();
+        readGpuFrameTimes(stats);
 
-        uint32_t imageIndex;
+        _redrawRequested.store(false, std::memory_order_release); // Arrivals from here on need another frame
+        updateResidency();
+        stats.cpuUpdateMs = lap();
 
-        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        uint32_t imageIndex = 0;
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || frameBufferResized) {
-            std::cout << "Resizing swapchain\n";
-            frameBufferResized = false;
-            recreateSwapChain();
-            return;
-        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-            throw std::runtime_error("failed to acquire swap chain image!");
+        if (_headless) {
+            collectFinishedReadbacks();
+            if (frameBufferResized) {
+                frameBufferResized = false;
+                recreateSwapChain();
+            }
+        } else {
+            VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || frameBufferResized) {
+                std::cout << "Resizing swapchain\n";
+                frameBufferResized = false;
+                recreateSwapChain();
+                _redrawRequested.store(true, std::memory_order_release); // Nothing was drawn
+                return;
+            } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+                throw std::runtime_error("failed to acquire swap chain image!");
+            }
         }
+        stats.cpuAcquireMs = lap();
 
         vkResetFences(device, 1, &inFlightFences[currentFrame]);
         vkResetCommandBuffer(commandBuffers[currentFrame],  0);
 
+        if (_frameTileSetVersion[currentFrame] != _tileSetVersion) {
+            refreshFrameTileSet(currentFrame);
+        }
+
         updateUniformBuffers(currentFrame);
 
-        recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        recordCommandBuffer(commandBuffers[currentFrame], [this](VkCommandBuffer commandBuffer) {
+            recordFramePrologue(commandBuffer);
+        });
+        // The draw only depends on the tile set and the swapchain, camera moves reuse it as recorded
+        size_t recorded = currentFrame * swapChainFramebuffers.size() + imageIndex;
+        if (frameCommandBufferTileSets[recorded] != _frameTileSetVersion[currentFrame]) {
+            vkResetCommandBuffer(frameCommandBuffers[recorded], 0);
+            recordCommandBuffer(frameCommandBuffers[recorded], [this, imageIndex](VkCommandBuffer commandBuffer) {
+                recordFrameDraw(commandBuffer, imageIndex);
+            });
+            frameCommandBufferTileSets[recorded] = _frameTileSetVersion[currentFrame];
+        }
+        std::array<VkCommandBuffer, 2> frameCommands = {commandBuffers[currentFrame], frameCommandBuffers[recorded]};
+        _drawnCameraVersion = _camera.getVersion();
+        _drawnTileSetVersion = _tileSetVersion;
+        stats.cpuRecordMs = lap();
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+        // Tile uploads only block the acquire barriers and mip blits, not the whole frame.
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        if (!_headless) {
+            waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+            waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        }
+        for (VkSemaphore semaphore : _uploadWaitSemaphores) {
+            waitSemaphores.push_back(semaphore);
+            waitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.commandBufferCount = static_cast<uint32_t>(frameCommands.size());
+        submitInfo.pCommandBuffers = frameCommands.data();
 
         VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = _headless ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
         
         if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
+        for (VkSemaphore semaphore : _uploadWaitSemaphores) {
+            _retiredUploadSemaphores.push_back({submittedFrames, semaphore});
+        }
+        _uploadWaitSemaphores.clear();
+        submittedFrames++;
+        stats.cpuSubmitMs = lap();
+
+        if (_headless) {
+            stats.cpuPresentMs = 0.0;
+            finishFrameStats(stats, frameStart);
+            currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+            return;
+        }
 
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1034,12 +2341,214 @@ public:
         presentInfo.pResults = nullptr;
 
         vkQueuePresentKHR(presentQueue, &presentInfo);
+        stats.cpuPresentMs = lap();
+        finishFrameStats(stats, frameStart);
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
     }
+
+    // Headless only. Draws the current view and reads it back as tightly packed RGBA8, the future is
+    // ready as soon as the GPU has finished that frame. With waitForTiles frames are drawn until every
+    // visible tile is resident, so the result does not depend on how fast tiles happened to stream in.
+    std::future<Veloxr::TextureData> renderOffscreen(bool waitForTiles = true) {
+        drawOffscreen(waitForTiles);
+        return submitReadback([](Veloxr::TextureData frame) { return frame; });
+    }
+
+    // Same, then writes it with OIIO on the pool. The future holds false if the write failed.
+    std::future<bool> renderOffscreenToFile(const std::string& filepath, bool waitForTiles = true) {
+        drawOffscreen(waitForTiles);
+        return submitReadback([filepath](Veloxr::TextureData frame) {
+            return Veloxr::OIIOTexture::save(filepath, frame.pixelData, {frame.width, frame.height});
+        });
+    }
+
+    // External only. Call where the host's render thread syncs with its UI (QQuickItem::updatePaintNode):
+    // applies a pending resize and returns the image to sample, a new one after a resize. The image is
+    // in SHADER_READ_ONLY_OPTIMAL whenever the host samples it.
+    VkImage prepareExternalFrame() {
+        if (!_external) {
+            throw std::runtime_error("external frames need initExternal()!");
+        }
+        if (frameBufferResized) {
+            frameBufferResized = false;
+            recreateSwapChain();
+            _redrawRequested.store(true, std::memory_order_release); // Undefined until drawn
+        }
+        return swapChainImages[0];
+    }
+
+    VkExtent2D getExternalExtent() const {
+        return swapChainExtent;
+    }
+
+    // External only. Records the frame into the host's command buffer, outside any render pass and ahead
+    // of the host's own pass that samples the image; the host submits it. frameSlot is the host's frame in
+    // flight index, the host must have waited for that slot's previous submission (Qt does before
+    // beforeRendering). Upload copies go to the same queue ahead of it, so no semaphores are needed.
+    void recordExternalFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot) {
+        if (!_external) {
+            throw std::runtime_error("external frames need initExternal()!");
+        }
+        if (frameSlot >= MAX_FRAMES_IN_FLIGHT) {
+            throw std::runtime_error("host has more frames in flight than the renderer!");
+        }
+        auto frameStart = std::chrono::steady_clock::now();
+        auto lapStart = frameStart;
+        auto lap = [&lapStart]() {
+            auto now = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(now - lapStart).count();
+            lapStart = now;
+            return ms;
+        };
+        Veloxr::FrameStats stats = _frameStats;
+
+        currentFrame = frameSlot;
+        stats.cpuWaitMs = 0.0; // The host waited for the slot
+        readGpuFrameTimes(stats);
+
+        _redrawRequested.store(false, std::memory_order_release);
+        updateResidency();
+        stats.cpuUpdateMs = lap();
+        stats.cpuAcquireMs = 0.0;
+
+        if (_frameTileSetVersion[currentFrame] != _tileSetVersion) {
+            refreshFrameTileSet(currentFrame);
+        }
+        updateUniformBuffers(currentFrame);
+        recordFrameCommands(commandBuffer, 0);
+        _drawnCameraVersion = _camera.getVersion();
+        _drawnTileSetVersion = _tileSetVersion;
+        stats.cpuRecordMs = lap();
+
+        // Submitted by the host, counted here so deferred destruction still retires
+        submittedFrames++;
+        stats.cpuSubmitMs = 0.0;
+        stats.cpuPresentMs = 0.0;
+        finishFrameStats(stats, frameStart);
+    }
 private:
 
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    // The slot's fence has just been waited on, so its queries are available without stalling.
+    void readGpuFrameTimes(Veloxr::FrameStats& stats) {
+        if (!_gpuTimer.read(currentFrame, stats.gpuUploadMs, stats.gpuRenderMs)) return;
+        _gpuFrameTimes.add(stats.gpuUploadMs + stats.gpuRenderMs);
+        stats.gpuFrameP50Ms = _gpuFrameTimes.percentile(0.50);
+        stats.gpuFrameP95Ms = _gpuFrameTimes.percentile(0.95);
+        stats.gpuFrameP99Ms = _gpuFrameTimes.percentile(0.99);
+    }
+
+    void finishFrameStats(Veloxr::FrameStats& stats, std::chrono::steady_clock::time_point frameStart) {
+        stats.cpuFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        stats.frames++;
+        _cpuFrameTimes.add(stats.cpuFrameMs);
+        stats.cpuFrameP50Ms = _cpuFrameTimes.percentile(0.50);
+        stats.cpuFrameP95Ms = _cpuFrameTimes.percentile(0.95);
+        stats.cpuFrameP99Ms = _cpuFrameTimes.percentile(0.99);
+        _frameStats = stats;
+    }
+
+    void drawOffscreen(bool waitForTiles) {
+        if (!_headless) {
+            throw std::runtime_error("offscreen rendering needs setHeadless() before init()!");
+        }
+        drawFrame();
+        while (waitForTiles && _residency.isInitialized() && !_residency.isSettled()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Loader threads are doing the work
+            drawFrame();
+        }
+    }
+
+    // Copies the offscreen image into its own buffer after everything submitted so far. A pool task
+    // waits for the copy and runs finish on the pixels, the render thread never blocks on it.
+    template <typename F>
+    auto submitReadback(F&& finish) -> std::future<std::invoke_result_t<F, Veloxr::TextureData>> {
+        OffscreenReadback readback{};
+        uint32_t width = swapChainExtent.width;
+        uint32_t height = swapChainExtent.height;
+        VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readback.buffer, readback.memory);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &readback.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate readback command buffer!");
+        }
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(readback.commandBuffer, &beginInfo);
+
+        // The render pass already left the image in TRANSFER_SRC and made its writes visible to transfers.
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {width, height, 1};
+        vkCmdCopyImageToBuffer(readback.commandBuffer, swapChainImages[0], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+
+        VkMemoryBarrier hostBarrier{};
+        hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(readback.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+        if (vkEndCommandBuffer(readback.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record readback command buffer!");
+        }
+
+        readback.fence = acquireUploadFence();
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &readback.commandBuffer;
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, readback.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit readback!");
+        }
+
+        using Result = std::invoke_result_t<F, Veloxr::TextureData>;
+        auto promise = std::make_shared<std::promise<Result>>();
+        std::future<Result> result = promise->get_future();
+        VkDevice readbackDevice = device;
+        VkFence fence = readback.fence;
+        const unsigned char* mapped = readback.memory.mapped;
+        readback.copied = Veloxr::ThreadPool::instance().async(Veloxr::TaskPriority::Low,
+            [readbackDevice, fence, mapped, width, height, promise, finish = std::forward<F>(finish)]() mutable {
+                try {
+                    if (vkWaitForFences(readbackDevice, 1, &fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+                        throw std::runtime_error("failed to wait for readback!");
+                    }
+                    Veloxr::TextureData frame{width, height, 4};
+                    frame.pixelData.assign(mapped, mapped + static_cast<size_t>(width) * height * 4);
+                    promise->set_value(finish(std::move(frame)));
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            });
+        _readbacksInFlight.push_back(std::move(readback));
+        return result;
+    }
+
+    // Frees readbacks whose pool task has copied the pixels out, wait blocks until all of them have.
+    void collectFinishedReadbacks(bool wait = false) {
+        for (auto it = _readbacksInFlight.begin(); it != _readbacksInFlight.end();) {
+            if (!wait && it->copied.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++it;
+                continue;
+            }
+            it->copied.wait();
+            vkFreeCommandBuffers(device, commandPool, 1, &it->commandBuffer);
+            vkResetFences(device, 1, &it->fence);
+            _freeUploadFences.push_back(it->fence);
+            vkDestroyBuffer(device, it->buffer, nullptr);
+            _allocator.free(it->memory);
+            it = _readbacksInFlight.erase(it);
+        }
+    }
+
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, const std::function<void(VkCommandBuffer)>& record) {
 
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -1048,6 +2557,30 @@ private:
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        record(commandBuffer);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
+
+    // Everything a frame does, into a command buffer that is already recording and outside a render pass.
+    void recordFrameCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        recordFramePrologue(commandBuffer);
+        recordFrameDraw(commandBuffer, imageIndex);
+    }
+
+    // The part that changes every frame: tiles uploaded since the last one.
+    void recordFramePrologue(VkCommandBuffer commandBuffer) {
+        _gpuTimer.recordBegin(commandBuffer, currentFrame);
+        recordPendingAcquires(commandBuffer);
+        _gpuTimer.recordUploadsDone(commandBuffer, currentFrame);
+    }
+
+    // Only reads this frame's buffers and descriptor sets, so a recording stays valid until they are reallocated.
+    void recordFrameDraw(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        recordCullPass(commandBuffer);
+
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = renderPass;
@@ -1077,21 +2610,52 @@ private:
         scissor.extent = swapChainExtent;
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        VkBuffer frameVertexBuffers[] = {quadBuffer, visibleInstanceBuffers[currentFrame]};
+        VkDeviceSize offsets[] = {0, 0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, frameVertexBuffers, offsets);
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
 
-        vkCmdDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), 1, 0, 0);
+        // Layer by layer, so finer levels are blended over coarser ones
+        for (uint32_t layer = 0; layer < _frameLayerStarts[currentFrame].size(); layer++) {
+            vkCmdDrawIndirect(commandBuffer, drawCommandBuffers[currentFrame], layer * sizeof(VkDrawIndirectCommand), 1, sizeof(VkDrawIndirectCommand));
+        }
         vkCmdEndRenderPass(commandBuffer);
+        _gpuTimer.recordEnd(commandBuffer, currentFrame);
+    }
 
-
-
-        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer!");
+    // Off screen tiles never reach the vertex stage, each layer's instance count comes from the GPU.
+    void recordCullPass(VkCommandBuffer commandBuffer) {
+        // The cull shader appends to the instance counts, layers it never reaches draw nothing
+        vkCmdFillBuffer(commandBuffer, drawCommandBuffers[currentFrame], 0, VK_WHOLE_SIZE, 0);
+        VkMemoryBarrier clearBarrier{};
+        clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSets[currentFrame], 0, nullptr);
+
+        // Layers write disjoint ranges and draw commands, their dispatches may overlap
+        const std::vector<uint32_t>& layerStarts = _frameLayerStarts[currentFrame];
+        uint32_t instanceCount = static_cast<uint32_t>(_frameInstances[currentFrame].size());
+        for (uint32_t layer = 0; layer < layerStarts.size(); layer++) {
+            CullConstants constants{};
+            constants.firstInstance = layerStarts[layer];
+            constants.instanceCount = (layer + 1 < layerStarts.size() ? layerStarts[layer + 1] : instanceCount) - layerStarts[layer];
+            constants.layer = layer;
+            uint32_t workgroups = std::min((constants.instanceCount + 255) / 256, _maxCullWorkgroups);
+            vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+            vkCmdDispatch(commandBuffer, workgroups, 1, 1);
         }
 
-
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
     }
 
     void createCommandBuffer() {
@@ -1109,18 +2673,46 @@ private:
 
     }
 
-    void createCommandPool() {
-        Veloxr::QueueFamilyIndices queueFamilyIndices = _deviceUtils->findQueueFamilies(physicalDevice);
+    // Called again after the swapchain is recreated, the device is idle then. External frames are
+    // recorded into the host's command buffer instead.
+    void createFrameCommandBuffers() {
+        if (_external) return;
+        if (!frameCommandBuffers.empty()) {
+            vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(frameCommandBuffers.size()), frameCommandBuffers.data());
+        }
+        frameCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT * swapChainFramebuffers.size());
+        frameCommandBufferTileSets.assign(frameCommandBuffers.size(), std::nullopt);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = (uint32_t) frameCommandBuffers.size();
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, frameCommandBuffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate frame command buffers!");
+        }
+    }
 
+    void createCommandPool() {
         VkCommandPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+        poolInfo.queueFamilyIndex = graphicsQueueFamily;
 
         if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
 
+        VkCommandPoolCreateInfo transferPoolInfo{};
+        transferPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        transferPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        transferPoolInfo.queueFamilyIndex = transferQueueFamily;
+
+        if (vkCreateCommandPool(device, &transferPoolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer command pool!");
+        }
+
     }
 
     void createFramebuffers() {
@@ -1155,7 +2747,8 @@ private:
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.finalLayout = _headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL :
+                                      _external ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
         // Subpass
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;// layout(location=0) out vec4 outColor
@@ -1174,14 +2767,45 @@ private:
         dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
+        // Headless frames share one image and no acquire semaphore orders them, so wait for the
+        // previous frame's writes and readback copies here and hand our writes on to the next copy.
+        std::vector<VkSubpassDependency> dependencies = {dependency};
+        if (_headless) {
+            dependencies[0].srcStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+            dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+            VkSubpassDependency readback{};
+            readback.srcSubpass = 0;
+            readback.dstSubpass = VK_SUBPASS_EXTERNAL;
+            readback.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            readback.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            readback.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            readback.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            dependencies.push_back(readback);
+        }
+        // External frames share one image the host samples later in the same command buffer, so wait
+        // for its reads of the previous frame and make our writes visible to its fragment shaders.
+        if (_external) {
+            dependencies[0].srcStageMask |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+            VkSubpassDependency sampled{};
+            sampled.srcSubpass = 0;
+            sampled.dstSubpass = VK_SUBPASS_EXTERNAL;
+            sampled.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            sampled.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            sampled.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            sampled.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            dependencies.push_back(sampled);
+        }
+
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
         renderPassInfo.attachmentCount = 1;
         renderPassInfo.pAttachments = &colorAttachment;
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
 
         if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
@@ -1190,12 +2814,14 @@ private:
     }
 
 
-    VkShaderModule createShaderModule(const std::vector<char>& code) {
+    // SPIR-V embedded at build time, see cmake/EmbedSpirv.cmake.
+    template <size_t N>
+    VkShaderModule createShaderModule(const uint32_t (&code)[N]) {
 
         VkShaderModuleCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        createInfo.codeSize = sizeof(code);
+        createInfo.pCode = code;
 
         VkShaderModule shaderModule;
         if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -1207,13 +2833,8 @@ private:
 
     // Immutable.
     void createGraphicsPipeline() {
-        //auto vertShaderCode = readFile(std::string(PROJECT_ROOT_DIR) + "/spirv/vert.spv");
-        //auto fragShaderCode = readFile(std::string(PROJECT_ROOT_DIR) + "/spirv/frag.spv");
-
-        auto vertShaderCode = readFile("C:/Users/ljuek/Work_Code/TestRenderer/spirv/vert.spv");
-        auto fragShaderCode = readFile("C:/Users/ljuek/Work_Code/TestRenderer/spirv/frag.spv");
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+        VkShaderModule vertShaderModule = createShaderModule(Veloxr::Shaders::vert);
+        VkShaderModule fragShaderModule = _bindless ? createShaderModule(Veloxr::Shaders::frag) : createShaderModule(Veloxr::Shaders::frag_array);
 
 
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
@@ -1231,16 +2852,15 @@ private:
 
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-        auto bindingDescription = Veloxr::Vertex::getBindingDescription();
-        auto attributeDescriptions = Veloxr::Vertex::getAttributeDescriptions();
+        auto bindingDescriptions = Veloxr::TileInstance::getBindingDescriptions();
+        auto attributeDescriptions = Veloxr::TileInstance::getAttributeDescriptions();
 
 
-        // Hardcoded in shader for now :D
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
         // Default, triangles
@@ -1354,7 +2974,7 @@ private:
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
         pipelineInfo.basePipelineIndex = -1; // Optional
 
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        if (vkCreateGraphicsPipelines(device, _pipelineCache.get(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
 
@@ -1362,6 +2982,63 @@ private:
         vkDestroyShaderModule(device, vertShaderModule, nullptr);
     }
 
+    // One dispatch per draw layer, see shaders/cull.comp. Bindings: uniforms, all instances, visible instances, draw commands.
+    void createCullPipeline() {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        _maxCullWorkgroups = properties.limits.maxComputeWorkGroupCount[0];
+
+        std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+        for (uint32_t i = 0; i < bindings.size(); i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullDescriptorSetLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull descriptor set layout!");
+        }
+
+        // The layer's instance range and draw command
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(CullConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull pipeline layout!");
+        }
+
+        VkShaderModule cullShaderModule = createShaderModule(Veloxr::Shaders::cull);
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = cullShaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = cullPipelineLayout;
+
+        if (vkCreateComputePipelines(device, _pipelineCache.get(), 1, &pipelineInfo, nullptr, &cullPipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull pipeline!");
+        }
+
+        vkDestroyShaderModule(device, cullShaderModule, nullptr);
+    }
+
     void createImageViews() {
 
         swapChainImageViews.resize(swapChainImages.size());
@@ -1374,6 +3051,10 @@ private:
     }
 
     void createSwapChain() {
+        if (rendersOffscreen()) {
+            createOffscreenTarget();
+            return;
+        }
         Veloxr::SwapChainSupportDetails swapChainSupport = _deviceUtils->querySwapChainSupport(physicalDevice);
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -1426,6 +3107,17 @@ private:
 
     }
 
+    // Stands in for the swapchain when headless or external, the render pass leaves it ready to be
+    // copied out or sampled by the host.
+    void createOffscreenTarget() {
+        swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        swapChainColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+        swapChainExtent = {static_cast<uint32_t>(std::max(_windowWidth, 1)), static_cast<uint32_t>(std::max(_windowHeight, 1))};
+        swapChainImages.resize(1);
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[0], _offscreenImageMemory,
+            1, _external ? static_cast<VkImageCreateFlags>(VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT) : 0); // Qt samples it through its own UNORM view, the sRGB-encoded bytes pass through
+    }
+
     void createSurfaceFromHandle(void* windowHandle) {
 
         VkWin32SurfaceCreateInfoKHR createInfo{};
@@ -1495,6 +3187,11 @@ private:
         int frames = 0;
         
         while (!glfwWindowShouldClose(window)) {
+            // Sleep until input or a loader's redraw callback wakes us, an unchanged view is not redrawn.
+            if (!needsRedraw()) {
+                glfwWaitEvents();
+                continue;
+            }
             auto now = std::chrono::high_resolution_clock::now();
             glfwPollEvents();
             drawFrame();
@@ -1520,24 +3217,47 @@ private:
 
 public:
     void destroy() {
+        vkDeviceWaitIdle(device);
 
+        collectFinishedReadbacks(true);
         cleanupSwapChain();
 
-        for(auto& [name, data] : _textureMap) data.destroy(device);
+        for(auto& [name, data] : _textureMap) data.destroy(device, _allocator);
+        releaseStreamedTiles(true);
+        for (StreamedTile& tile : _texturePool.clear()) tile.texture.destroy(device, _allocator);
+        destroyUploadResources();
+        _gpuTimer.destroy();
+        _pipelineCache.destroy();
+        _tileCache.close();
+        _compressedCache.close();
+        _tileArray.destroy(device, _allocator);
+        vkDestroySampler(device, _tileSampler, nullptr);
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-            vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+            _allocator.free(uniformBuffersMemory[i]);
         }
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        vkDestroyDescriptorPool(device, cullDescriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, nullptr);
 
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        vkDestroyPipeline(device, cullPipeline, nullptr);
+        vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
         vkDestroyRenderPass(device, renderPass, nullptr);
 
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
+        vkDestroyBuffer(device, quadBuffer, nullptr);
+        _allocator.free(quadBufferMemory);
+        for (size_t i = 0; i < instanceBuffers.size(); i++) {
+            vkDestroyBuffer(device, instanceBuffers[i], nullptr);
+            _allocator.free(instanceBuffersMemory[i]);
+            vkDestroyBuffer(device, visibleInstanceBuffers[i], nullptr);
+            _allocator.free(visibleInstanceBuffersMemory[i]);
+            vkDestroyBuffer(device, drawCommandBuffers[i], nullptr);
+            _allocator.free(drawCommandBuffersMemory[i]);
+        }
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
@@ -1546,17 +3266,24 @@ public:
         }
 
         vkDestroyCommandPool(device, commandPool, nullptr);
+        vkDestroyCommandPool(device, transferCommandPool, nullptr);
+        _allocator.destroy();
 
+        // The host owns the device and instance
+        if (_external) {
+            device = VK_NULL_HANDLE;
+            return;
+        }
         vkDestroyDevice(device, nullptr);
 
         if (enableValidationLayers) {
             DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
         }
 
-        vkDestroySurfaceKHR(instance, surface, nullptr);
+        if (surface != VK_NULL_HANDLE) vkDestroySurfaceKHR(instance, surface, nullptr);
         vkDestroyInstance(instance, nullptr);
 
-        glfwDestroyWindow(window);
+        if (window) glfwDestroyWindow(window);
 
         glfwTerminate();
     }
@@ -1619,7 +3346,7 @@ private:
         appInfo.applicationVersion = VK_MAKE_VERSION(0, 0, 1);
         appInfo.pEngineName = "Cast";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 1);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VK_API_VERSION_1_1; // vkGetPhysicalDeviceFeatures2 for the descriptor indexing query
 
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -1627,13 +3354,18 @@ private:
 
         std::vector<const char*> requiredExtensions;
 
-        requiredExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);  // This is the critical addition!
+        // Headless never creates a surface, nodes without a display may not have these at all.
+        if (!_headless) {
+            requiredExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);  // This is the critical addition!
+#ifdef __APPLE__
+            requiredExtensions.push_back(VK_EXT_METAL_SURFACE_EXTENSION_NAME);
+#elif defined(_WIN32)
+            requiredExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
+        }
 
 #ifdef __APPLE__
         requiredExtensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
-        requiredExtensions.push_back(VK_EXT_METAL_SURFACE_EXTENSION_NAME);
-#elif defined(_WIN32)
-        requiredExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #endif
 
         if (enableValidationLayers) {
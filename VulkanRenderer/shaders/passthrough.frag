@@ -1,15 +1,15 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec4 fragTexCoord;
 layout(location = 1) in flat int texUnit;
 
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 1) uniform sampler2D texSamplers[16];
+// One slot per resident tile, only slots of resident tiles are ever bound.
+layout(binding = 1) uniform texture2D tileTextures[];
+layout(binding = 2) uniform sampler tileSampler;
 
 void main() {
-    outColor = texture(texSamplers[texUnit], fragTexCoord.xy);
-    // blend for testing :D
-    //outColor = 0.5 * texture(texSamplers[0], fragTexCoord.xy) + 0.5 * texture(texSamplers[1], fragTexCoord.xy);
-
+    outColor = texture(sampler2D(tileTextures[nonuniformEXT(texUnit)], tileSampler), fragTexCoord.xy);
 }
@@ -1,22 +1,24 @@
 #version 450
 
-layout(location = 0) in vec4 inPosition;
-layout(location = 1) in vec4 inTexCoord;
-layout(location = 2) in int inTextureUnit;
+// Unit quad corner, per vertex
+layout(location = 0) in vec2 inCorner;
+// Tile, per instance
+layout(location = 1) in vec4 inRect;
+layout(location = 2) in vec4 inUvRect;
+layout(location = 3) in int inTextureUnit;
 
 layout(location = 0) out vec4 fragTexCoord;
 layout(location = 1) out flat int texUnit;
 
 
 layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
-    mat4 view;
-    mat4 proj;
+    mat4 viewProj;
 } ubo;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition.xy, 0.0, 1.0);
-    //gl_Position = vec4(inPosition, 0.0, 1.0);
-    fragTexCoord = inTexCoord;
+    vec2 position = mix(inRect.xy, inRect.zw, inCorner);
+    gl_Position = ubo.viewProj * vec4(position, 0.0, 1.0);
+    // zw carries the far texel edge for the array fallback to clamp against
+    fragTexCoord = vec4(mix(inUvRect.xy, inUvRect.zw, inCorner), inUvRect.zw);
     texUnit = inTextureUnit;
 }
@@ -0,0 +1,16 @@
+#version 450
+
+layout(location = 0) in vec4 fragTexCoord;
+layout(location = 1) in flat int texUnit;
+
+layout(location = 0) out vec4 outColor;
+
+// Fallback without descriptor indexing, each tile is one layer. Edge tiles only fill
+// the top-left of their layer, clamping half a texel inside zw keeps filtering off the
+// unused texels.
+layout(binding = 1) uniform sampler2DArray tileArray;
+
+void main() {
+    vec2 uv = min(fragTexCoord.xy, fragTexCoord.zw - 0.5 / vec2(textureSize(tileArray, 0).xy));
+    outColor = texture(tileArray, vec3(uv, float(texUnit)));
+}
@@ -0,0 +1,127 @@
+#include <TileCache.h>
+#include <TileResidency.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+using namespace Veloxr;
+
+namespace {
+    // ctest reads this as skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+    constexpr int SKIPPED = 77;
+
+    int failures = 0;
+
+    void check(bool condition, const char* what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    // Tile layout for an extent far beyond 2^32 pixels, nothing is allocated for it.
+    void testMockedExtent() {
+        constexpr uint32_t width = 3'000'000'000u;
+        constexpr uint32_t height = 2'000'000'000u;
+        constexpr uint32_t tileSize = 2048;
+
+        TileResidency residency;
+        residency.init(width, height, tileSize, 512ull << 20, 256);
+
+        // ceil(3e9 / 2^21) is the first level width at or below one tile
+        check(residency.getLevelCount() == 22, "level count of a 3e9 x 2e9 image");
+
+        TileRegion first = residency.region({0, 0, 0});
+        check(first.levelWidth == width && first.levelHeight == height, "level 0 size");
+        TileRegion half = residency.region({1, 0, 0});
+        check(half.levelWidth == width / 2 && half.levelHeight == height / 2, "level 1 size");
+        TileRegion top = residency.region(residency.getFallbackTile());
+        check(top.levelWidth == 1431 && top.levelHeight == 954, "top level size");
+        check(top.x1 == top.levelWidth && top.y1 == top.levelHeight, "top level fits one tile");
+
+        // 1464844 columns and 976563 rows, the last of each is partial
+        TileRegion last = residency.region({0, 1464843, 976562});
+        check(last.x0 == 2'999'998'464u && last.x1 == width, "last column offset");
+        check(last.y0 == 1'999'998'976u && last.y1 == height, "last row offset");
+        check(last.right == 1.0f && last.bottom == 1.0f, "last tile reaches the image edge");
+        // Mip chains included
+        check(residency.tileBytes({0, 1464843, 976562}) == 1536ull * 1024 * 4 * 4 / 3, "last tile bytes");
+        check(residency.tileBytes({0, 0, 0}) == 2048ull * 2048 * 4 * 4 / 3, "full tile bytes");
+
+        TileRegion middle = residency.region({0, 1000000, 500000});
+        check(middle.x0 == 2'048'000'000u && middle.y0 == 1'024'000'000u, "tile offset past 2^31");
+    }
+
+    // An RGBA8 cache of a 66000 x 66000 image is a ~23 GB sparse file, its level 0 tiles sit past 4 GiB.
+    int testSparseCache() {
+        constexpr uint32_t size = 66000;
+        constexpr uint32_t tileSize = 1024;
+
+        std::error_code ec;
+        std::filesystem::path directory = std::filesystem::temp_directory_path(ec) / "veloxr-large-image-test";
+        std::filesystem::create_directories(directory, ec);
+        std::filesystem::path source = directory / "source.bin";
+        {
+            // Only stat'ed by the cache
+            std::ofstream file(source, std::ios::binary | std::ios::trunc);
+            file << "veloxr";
+        }
+
+        TileResidency residency;
+        residency.init(size, size, tileSize, 512ull << 20, 256);
+
+        int result = 0;
+        {
+            TileCache cache;
+            if (!cache.open(source.string(), size, size, tileSize, residency.getLevelCount(), directory.string())) {
+                std::printf("Skipping the sparse cache test, %s cannot hold a sparse file this large\n", directory.string().c_str());
+                result = SKIPPED;
+            } else {
+                auto tileFor = [&](const TileKey& key, unsigned char seed) {
+                    TileRegion r = residency.region(key);
+                    TextureData data{};
+                    data.width = r.x1 - r.x0;
+                    data.height = r.y1 - r.y0;
+                    data.channels = 4;
+                    data.format = TileFormat::RGBA8;
+                    data.pixelData.resize(static_cast<size_t>(data.width) * data.height * 4);
+                    for (size_t i = 0; i < data.pixelData.size(); i++) {
+                        data.pixelData[i] = static_cast<unsigned char>(seed + i * 7);
+                    }
+                    return data;
+                };
+
+                // The corner tiles land below and far above 4 GiB, wrapped offsets would make them overlap.
+                const TileKey keys[] = {{0, 0, 0}, {0, 64, 0}, {0, 0, 64}, {0, 64, 64}, residency.getFallbackTile()};
+                unsigned char seed = 1;
+                for (const TileKey& key : keys) {
+                    check(cache.writeTile(key, tileFor(key, seed++)), "write tile");
+                }
+                seed = 1;
+                for (const TileKey& key : keys) {
+                    TextureData expected = tileFor(key, seed++);
+                    TextureData actual = cache.readTile(key);
+                    check(actual.width == expected.width && actual.height == expected.height, "tile size read back");
+                    check(actual.pixelData == expected.pixelData, "tile pixels read back");
+                }
+                check(cache.readTile({0, 64, 64}).width == size - 64 * tileSize, "last column width");
+                check(!cache.hasTile({0, 32, 32}), "untouched tile stays empty");
+            }
+        }
+        std::filesystem::remove_all(directory, ec);
+        return result;
+    }
+}
+
+int main() {
+    testMockedExtent();
+    int sparse = testSparseCache();
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return sparse;
+}
@@ -2,11 +2,193 @@
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
+#include <PixelConversion.h>
+#include <ThreadPool.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <vector>
 
+#ifdef VELOXR_HAS_LIBJPEG
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
 using namespace Veloxr;
 OIIO_NAMESPACE_USING  
 
+namespace {
+    using RowCallback = std::function<void(const unsigned char*)>;
+
+    uint32_t scaledSize(uint32_t size, uint32_t level) {
+        return std::max<uint32_t>(1, static_cast<uint32_t>((static_cast<uint64_t>(size) + (1ull << level) - 1) >> level));
+    }
+
+    // Halves incoming RGBA8 rows `levels` times. One pending row per level, like the tile cache
+    // builder, so the full resolution rows are never held in memory.
+    class HalvingCascade {
+
+        public:
+            HalvingCascade(uint32_t width, uint32_t levels, RowCallback emit)
+                : _levels(levels), _emit(std::move(emit)) {
+                for (uint32_t level = 0; level < levels; level++) {
+                    uint32_t levelWidth = scaledSize(width, level);
+                    _widths.push_back(levelWidth);
+                    _pending.emplace_back(static_cast<size_t>(levelWidth) * 4);
+                    _output.emplace_back(static_cast<size_t>(scaledSize(width, level + 1)) * 4);
+                }
+                _hasPending.assign(levels, false);
+            }
+
+            void push(const unsigned char* row) { _push(0, row); }
+
+            // An odd last row is averaged with itself on its way up.
+            void finish() {
+                for (uint32_t level = 0; level < _levels; level++) {
+                    if (!_hasPending[level]) continue;
+                    _hasPending[level] = false;
+                    PixelConversion::halveRGBA8(_pending[level].data(), _pending[level].data(), _output[level].data(), _widths[level]);
+                    _push(level + 1, _output[level].data());
+                }
+            }
+
+        private:
+            void _push(uint32_t level, const unsigned char* row) {
+                if (level == _levels) {
+                    _emit(row);
+                    return;
+                }
+                if (!_hasPending[level]) {
+                    std::memcpy(_pending[level].data(), row, _pending[level].size());
+                    _hasPending[level] = true;
+                    return;
+                }
+                _hasPending[level] = false;
+                PixelConversion::halveRGBA8(_pending[level].data(), row, _output[level].data(), _widths[level]);
+                _push(level + 1, _output[level].data());
+            }
+
+            uint32_t _levels;
+            RowCallback _emit;
+            std::vector<uint32_t> _widths;
+            std::vector<std::vector<unsigned char>> _pending;
+            std::vector<std::vector<unsigned char>> _output;
+            std::vector<bool> _hasPending;
+    };
+
+    // Rows [y0, y1) of the full resolution image, columns [x0, x1), read in small bands.
+    bool readScanlineRows(const std::string& filename, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, const RowCallback& emit) {
+        auto in = OIIO::ImageInput::open(filename);
+        if (!in) {
+            std::cerr << "Could not open input: " << filename << "\n";
+            return false;
+        }
+        const OIIO::ImageSpec &spec = in->spec();
+        uint32_t channels = spec.nchannels;
+        uint32_t sampleBytes = spec.format == OIIO::TypeDesc::UINT16 ? 2 : 1;
+        OIIO::TypeDesc readFormat = sampleBytes == 2 ? OIIO::TypeDesc::UINT16 : OIIO::TypeDesc::UINT8;
+        size_t rowBytes = static_cast<size_t>(spec.width) * channels * sampleBytes;
+
+        constexpr uint32_t BAND_ROWS = 16;
+        std::vector<unsigned char> band(rowBytes * BAND_ROWS);
+        std::vector<unsigned char> rgba(static_cast<size_t>(x1 - x0) * 4);
+        for (uint32_t y = y0; y < y1; y += BAND_ROWS) {
+            uint32_t end = std::min(y + BAND_ROWS, y1);
+            if (!in->read_scanlines(0, 0, y, end, 0, 0, channels, readFormat, band.data())) {
+                std::cerr << "Error reading scanlines " << y << "-" << end << ": " << in->geterror() << std::endl;
+                in->close();
+                return false;
+            }
+            for (uint32_t row = 0; row < end - y; row++) {
+                PixelConversion::toRGBA8(band.data() + row * rowBytes + static_cast<size_t>(x0) * channels * sampleBytes, sampleBytes,
+                                         rgba.data(), x1 - x0, channels);
+                emit(rgba.data());
+            }
+        }
+        in->close();
+        return true;
+    }
+
+#ifdef VELOXR_HAS_LIBJPEG
+    // Heap allocated before setjmp so nothing the error path touches lives in a clobberable local.
+    struct JpegDecoder {
+        jpeg_decompress_struct info{};
+        jpeg_error_mgr error{};
+        std::jmp_buf jump;
+        FILE* file{nullptr};
+        std::vector<unsigned char> row;
+        std::vector<unsigned char> rgba;
+
+        ~JpegDecoder() {
+            jpeg_destroy_decompress(&info);
+            if (file) std::fclose(file);
+        }
+    };
+
+    void jpegErrorExit(j_common_ptr info) {
+        char message[JMSG_LENGTH_MAX];
+        info->err->format_message(info, message);
+        std::cerr << "[JPEG] " << message << "\n";
+        std::longjmp(reinterpret_cast<JpegDecoder*>(info->client_data)->jump, 1);
+    }
+
+    // Rows [y0, y1) and columns [x0, x1) of the JPEG decoded at 1 / 2^scaleLog2, at most 1/8.
+    // libjpeg skips the IDCT work for the dropped frequencies, so this is several times faster than
+    // a full decode. False for anything that is not a JPEG libjpeg can turn into gray or RGB.
+    bool readJpegRows(const std::string& filename, uint32_t scaleLog2, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, const RowCallback& emit) {
+        auto decoder = std::make_unique<JpegDecoder>();
+        decoder->file = std::fopen(filename.c_str(), "rb");
+        if (!decoder->file) return false;
+        unsigned char magic[2] = {};
+        if (std::fread(magic, 1, 2, decoder->file) != 2 || magic[0] != 0xFF || magic[1] != 0xD8) return false;
+        std::rewind(decoder->file);
+
+        jpeg_decompress_struct& info = decoder->info;
+        info.err = jpeg_std_error(&decoder->error);
+        decoder->error.error_exit = jpegErrorExit;
+        info.client_data = decoder.get();
+        if (setjmp(decoder->jump)) return false;
+
+        jpeg_create_decompress(&info);
+        info.client_data = decoder.get(); // jpeg_create_decompress clears it
+        jpeg_stdio_src(&info, decoder->file);
+        jpeg_read_header(&info, TRUE);
+        // CMYK needs OIIO's conversion
+        if (info.jpeg_color_space == JCS_CMYK || info.jpeg_color_space == JCS_YCCK) return false;
+        info.out_color_space = info.num_components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+        info.scale_num = 1;
+        info.scale_denom = 1u << std::min(scaleLog2, 3u);
+        jpeg_start_decompress(&info);
+
+        uint32_t channels = info.output_components;
+        uint32_t skipX = x0;
+#ifdef LIBJPEG_TURBO_VERSION
+        // Only the iMCU columns around the rect are decoded, the crop snaps x0 down to one.
+        if (x0 > 0 || x1 < info.output_width) {
+            JDIMENSION cropX = x0;
+            JDIMENSION cropWidth = x1 - x0;
+            jpeg_crop_scanline(&info, &cropX, &cropWidth);
+            skipX = x0 - cropX;
+        }
+        if (y0 > 0) jpeg_skip_scanlines(&info, y0);
+#endif
+        decoder->row.resize(static_cast<size_t>(info.output_width) * channels);
+        decoder->rgba.resize(static_cast<size_t>(x1 - x0) * 4);
+        while (info.output_scanline < y1) {
+            uint32_t y = info.output_scanline;
+            JSAMPROW row = decoder->row.data();
+            jpeg_read_scanlines(&info, &row, 1);
+            if (y < y0) continue;
+            PixelConversion::toRGBA8(decoder->row.data() + static_cast<size_t>(skipX) * channels, decoder->rgba.data(), x1 - x0, channels);
+            emit(decoder->rgba.data());
+        }
+        jpeg_abort_decompress(&info); // The rows below y1 are never decoded
+        return true;
+    }
+#endif
+}
+
 OIIOTexture::OIIOTexture(std::string filename) {
     init(filename);
 }
@@ -17,6 +199,8 @@ void OIIOTexture::init(std::string filename) {
     auto in = ImageInput::open(_filename);
     if (!in) {
         std::cerr << "Could not open input: " << _filename << "\n";
+        _loaded = false;
+        return;
     }
 
     const ImageSpec &in_spec = in->spec();
@@ -38,17 +222,93 @@ std::vector<unsigned char> OIIOTexture::load(std::string filename) {
         throw std::runtime_error("Failed to open image with OIIO: " + filename);
     }
 
-    std::vector<unsigned char> rawData(_resolution.x * _resolution.y * _numChannels);
-    in->read_image(0, 0, 0, _numChannels, OIIO::TypeDesc::UINT8, rawData.data());
+    // 16-bit sources are narrowed by PixelConversion instead of OIIO's per-sample conversion.
+    uint32_t sampleBytes = in->spec().format == OIIO::TypeDesc::UINT16 ? 2 : 1;
+    size_t pixels = static_cast<size_t>(_resolution.x) * _resolution.y;
+    std::vector<unsigned char> rawData(pixels * _numChannels * sampleBytes);
+    in->read_image(0, 0, 0, _numChannels, sampleBytes == 2 ? OIIO::TypeDesc::UINT16 : OIIO::TypeDesc::UINT8, rawData.data());
     in->close();
     in.reset();
 
-    std::vector<unsigned char> pixelData(_resolution.x * _resolution.y * 4, 255);
-    for (uint32_t i = 0; i < _resolution.x * _resolution.y; ++i) {
-        for (int c = 0; c < _numChannels && c < 4; ++c) {
-            pixelData[i * 4 + c] = rawData[i * _numChannels + c];
-        }
+    // Conversion is memory bound, split it into row chunks so large images use every core.
+    constexpr size_t CHUNK_PIXELS = 1u << 20;
+    std::vector<unsigned char> pixelData(pixels * 4);
+    TaskGroup group;
+    for (size_t first = 0; first < pixels; first += CHUNK_PIXELS) {
+        size_t count = std::min(CHUNK_PIXELS, pixels - first);
+        group.run([&, first, count]() {
+            PixelConversion::toRGBA8(rawData.data() + first * _numChannels * sampleBytes, sampleBytes,
+                                     pixelData.data() + first * 4, count, _numChannels);
+        });
     }
+    group.wait();
     _numChannels = 4; // Forcing rgba, lets stick to this.
     return pixelData; 
 }
+
+bool OIIOTexture::save(const std::string& filename, const std::vector<unsigned char>& pixels, const Point& size) {
+    if (pixels.size() < size.area() * 4) {
+        std::cerr << "Not enough pixels to save " << filename << "\n";
+        return false;
+    }
+    auto out = ImageOutput::create(filename);
+    if (!out) {
+        std::cerr << "Could not create output: " << filename << "\n";
+        return false;
+    }
+    ImageSpec spec(size.x, size.y, 4, TypeDesc::UINT8);
+    if (!out->open(filename, spec) || !out->write_image(TypeDesc::UINT8, pixels.data())) {
+        std::cerr << "Error writing " << filename << ": " << out->geterror() << std::endl;
+        return false;
+    }
+    return out->close();
+}
+
+std::vector<unsigned char> OIIOTexture::loadScaled(uint32_t level, Point& size) const {
+    size = {scaledSize(_resolution.x, level), scaledSize(_resolution.y, level)};
+    return loadScaledRegion(level, 0, 0, size.x, size.y);
+}
+
+std::vector<unsigned char> OIIOTexture::loadScaledRegion(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) const {
+    if (!_loaded) {
+        std::cerr << "You did not initialize your OIIOTexture.\n";
+        return {};
+    }
+    x1 = std::min(x1, scaledSize(_resolution.x, level));
+    y1 = std::min(y1, scaledSize(_resolution.y, level));
+    if (x0 >= x1 || y0 >= y1) return {};
+
+    uint32_t outW = x1 - x0;
+    std::vector<unsigned char> pixels;
+    pixels.reserve(static_cast<size_t>(outW) * (y1 - y0) * 4);
+
+    // The source is read at 1 / 2^baseLevel, the cascade covers the rest. Rect corners are multiples of
+    // 2^remaining in the source, so every 2x2 block lines up with the pyramid's.
+    auto decode = [&](uint32_t baseLevel, auto&& readRows) {
+        uint32_t remaining = level - baseLevel;
+        uint32_t sx0 = static_cast<uint32_t>(static_cast<uint64_t>(x0) << remaining);
+        uint32_t sy0 = static_cast<uint32_t>(static_cast<uint64_t>(y0) << remaining);
+        uint32_t sx1 = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(x1) << remaining, scaledSize(_resolution.x, baseLevel)));
+        uint32_t sy1 = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(y1) << remaining, scaledSize(_resolution.y, baseLevel)));
+        pixels.clear();
+        HalvingCascade cascade(sx1 - sx0, remaining, [&](const unsigned char* row) {
+            pixels.insert(pixels.end(), row, row + static_cast<size_t>(outW) * 4);
+        });
+        if (!readRows(sx0, sy0, sx1, sy1, [&](const unsigned char* row) { cascade.push(row); })) return false;
+        cascade.finish();
+        return true;
+    };
+
+#ifdef VELOXR_HAS_LIBJPEG
+    uint32_t dctLevel = std::min(level, 3u);
+    bool jpeg = decode(dctLevel, [&](uint32_t sx0, uint32_t sy0, uint32_t sx1, uint32_t sy1, const RowCallback& emit) {
+        return readJpegRows(_filename, dctLevel, sx0, sy0, sx1, sy1, emit);
+    });
+    if (jpeg) return pixels;
+#endif
+    bool ok = decode(0, [&](uint32_t sx0, uint32_t sy0, uint32_t sx1, uint32_t sy1, const RowCallback& emit) {
+        return readScanlineRows(_filename, sx0, sy0, sx1, sy1, emit);
+    });
+    if (!ok) return {};
+    return pixels;
+}
@@ -6,8 +6,11 @@
 
 namespace Veloxr {
 
+    // Each axis fits 32 bits, anything derived from both (pixel counts, byte offsets) needs area() or 64-bit math.
     struct Point {
         uint32_t x, y;
+
+        inline uint64_t area() const { return static_cast<uint64_t>(x) * y; }
     };
 
     class VULKANRENDERER_EXPORT OIIOTexture {
@@ -20,8 +23,17 @@ namespace Veloxr {
             inline const std::string& getFilename() const { return _filename; }
             inline const int& getNumChannels() const { return _numChannels; }
             std::vector<unsigned char> load(std::string filename="");
+            // The image at 1 / 2^level per axis as RGBA8, sized like pyramid level `level` (rounded up).
+            // JPEGs decode straight at 1/2, 1/4 or 1/8 in the DCT domain when built with libjpeg, any
+            // remaining factor and every other format go through a streaming 2x2 box filter.
+            std::vector<unsigned char> loadScaled(uint32_t level, Point& size) const;
+            // Pixel rect [x0, x1) x [y0, y1) of that image, clamped to it.
+            std::vector<unsigned char> loadScaledRegion(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) const;
             inline const bool isInitialized() const { return _loaded; }
 
+            // Writes tightly packed RGBA8 pixels, the format follows the file extension.
+            static bool save(const std::string& filename, const std::vector<unsigned char>& pixels, const Point& size);
+
         private:
             Point _resolution;
             std::string _filename;
@@ -1,11 +1,15 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QQuickWindow>
 #include <vulkanrenderitem.h>
 
 int main(int argc, char *argv[])
 {
     qputenv("QT_IM_MODULE", QByteArray("qtvirtualkeyboard"));
 
+    // VulkanRenderItem draws with the scene graph's own device
+    QQuickWindow::setGraphicsApi(QSGRendererInterface::Vulkan);
+
     QGuiApplication app(argc, argv);
 
     qmlRegisterType<VulkanRenderItem>("VulkanRenderItem", 1, 0, "VulkanRenderItem");
@@ -16,6 +20,8 @@ int main(int argc, char *argv[])
         &app,
         []() { QCoreApplication::exit(-1); },
         Qt::QueuedConnection);
+    // VELOXR_HUD=1 shows the frame timing overlay
+    engine.setInitialProperties({{"showHud", qEnvironmentVariableIntValue("VELOXR_HUD") != 0}});
     engine.loadFromModule("TestRenderer", "Main");
 
     return app.exec();
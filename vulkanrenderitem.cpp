@@ -1,140 +1,190 @@
 #include "vulkanrenderitem.h"
 #include <QDebug>
 #include <QQuickWindow>
+#include <QSGRendererInterface>
+#include <QSGSimpleTextureNode>
+#include <QVulkanInstance>
+#include <QtQuick/qsgtexture_platform.h>
+
+namespace {
+
+    // Owns the renderer, created and destroyed on the render thread by the scene graph. Not a Q_OBJECT,
+    // it is only the context of its beforeRendering connection, which goes away with it.
+    class VulkanRenderNode : public QObject, public QSGSimpleTextureNode {
+    public:
+        VulkanRenderNode(QQuickWindow *window, std::shared_ptr<FrameStatsChannel> stats)
+            : m_window(window), m_stats(std::move(stats)) {
+            setOwnsTexture(true);
+        }
 
-VulkanRenderItem::VulkanRenderItem(QQuickItem *parent) : QQuickItem(parent) {
-    // Set up necessary flags for rendering
-    setFlag(QQuickItem::ItemHasContents, true);
-
-    // Connect to window changed signal to handle window initialization
-    connect(this, &QQuickItem::windowChanged, this, &VulkanRenderItem::handleWindowChanged);
-}
-
-VulkanRenderItem::~VulkanRenderItem() {
-    cleanup();
-}
-
-void VulkanRenderItem::handleWindowChanged(QQuickWindow *win) {
-    if (win) {
-        connect(win, &QQuickWindow::afterRendering, this, &VulkanRenderItem::handleAfterRendering, Qt::DirectConnection);
-        connect(win, &QQuickWindow::beforeRendering, this, &VulkanRenderItem::render, Qt::DirectConnection);
+        ~VulkanRenderNode() override {
+            if (!m_core) return;
+            try {
+                m_core->destroy();
+            } catch (const std::exception& e) {
+                qWarning() << "Error during cleanup:" << e.what();
+            }
+        }
 
-        //win->setClearBeforeRendering(false);
-    }
-}
+        bool initialize(const QSize &pixelSize) {
+            QSGRendererInterface *rif = m_window->rendererInterface();
+            if (rif->graphicsApi() != QSGRendererInterface::Vulkan) {
+                qWarning() << "VulkanRenderItem needs the Vulkan scene graph backend, see QQuickWindow::setGraphicsApi()";
+                return false;
+            }
+            auto *inst = static_cast<QVulkanInstance *>(rif->getResource(m_window, QSGRendererInterface::VulkanInstanceResource));
+            auto *physicalDevice = static_cast<VkPhysicalDevice *>(rif->getResource(m_window, QSGRendererInterface::PhysicalDeviceResource));
+            auto *device = static_cast<VkDevice *>(rif->getResource(m_window, QSGRendererInterface::DeviceResource));
+            auto *queue = static_cast<VkQueue *>(rif->getResource(m_window, QSGRendererInterface::CommandQueueResource));
+            auto *queueFamily = static_cast<uint32_t *>(rif->getResource(m_window, QSGRendererInterface::GraphicsQueueFamilyIndexResource));
+            if (!inst || !physicalDevice || !device || !queue || !queueFamily) {
+                qWarning() << "Scene graph did not expose its Vulkan device";
+                return false;
+            }
+            if (m_window->graphicsStateInfo().framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+                qWarning() << "Scene graph runs" << m_window->graphicsStateInfo().framesInFlight << "frames in flight, the renderer supports" << MAX_FRAMES_IN_FLIGHT;
+                return false;
+            }
 
-void VulkanRenderItem::handleAfterRendering() {
-    if (!m_windowHandleReady) {
-        m_windowHandle = getNativeWindowHandle();
-        if (m_windowHandle) {
-            m_windowHandleReady = true;
-            qDebug() << "Window handle is ready";
-            emit readyChanged();
+            try {
+                auto core = std::make_unique<RendererCore>();
+                core->setWindowDimensions(pixelSize.width(), pixelSize.height());
+                core->setInitialImage(qEnvironmentVariable("VELOXR_IMAGE").toStdString());
+                // Loader threads call this, hop to the GUI thread before touching the window
+                QQuickWindow *window = m_window;
+                core->setRedrawCallback([window]() {
+                    QMetaObject::invokeMethod(window, [window]() { window->update(); }, Qt::QueuedConnection);
+                });
+                core->initExternal(inst->vkInstance(), {*physicalDevice, *device, *queue, *queueFamily});
+                m_core = std::move(core);
+            } catch (const std::exception& e) {
+                qWarning() << "Failed to initialize Vulkan renderer:" << e.what();
+                return false;
+            }
+            m_pixelSize = pixelSize;
 
-            // Initialize the Vulkan renderer with the window handle
-            initializeExternalRenderer();
+            connect(m_window, &QQuickWindow::beforeRendering, this, [this]() { render(); }, Qt::DirectConnection);
+            qDebug() << "Vulkan renderer initialized on the scene graph's device";
+            return true;
+        }
 
-            // Disconnect so initialization is only called once
-            if (window()) {
-                disconnect(window(), &QQuickWindow::afterRendering, this, &VulkanRenderItem::handleAfterRendering);
+        // GUI thread is blocked, safe to take the item's state.
+        void sync(const QSize &pixelSize, const QRectF &rect) {
+            if (pixelSize != m_pixelSize) {
+                m_pixelSize = pixelSize;
+                m_core->setWindowDimensions(pixelSize.width(), pixelSize.height());
+            }
+            try {
+                VkImage image = m_core->prepareExternalFrame();
+                if (image != m_image || !texture()) {
+                    // Wraps the image without owning it, the previous wrapper is deleted by setTexture()
+                    m_image = image;
+                    VkExtent2D extent = m_core->getExternalExtent();
+                    setTexture(QNativeInterface::QSGVulkanTexture::fromNative(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                        m_window, QSize(static_cast<int>(extent.width), static_cast<int>(extent.height))));
+                }
+            } catch (const std::exception& e) {
+                qWarning() << "Error resizing the render target:" << e.what();
             }
+            setRect(rect);
         }
-    }
-}
 
-void VulkanRenderItem::render() {
-    // Only render if the renderer is initialized
-    if (m_windowHandleReady && m_rendererInitialized) {
-        try {
-            // Draw a frame using the Vulkan renderer
-            core.drawFrame();
+    private:
+        // Before the scene graph's render pass, its command buffer is recording and outside a pass.
+        void render() {
+            // Only record if something changed, the image keeps the last frame otherwise
+            if (!m_core || !m_core->needsRedraw()) return;
+            QSGRendererInterface *rif = m_window->rendererInterface();
+            auto *commandBuffer = static_cast<VkCommandBuffer *>(rif->getResource(m_window, QSGRendererInterface::CommandListResource));
+            if (!commandBuffer) return;
+
+            m_window->beginExternalCommands();
+            try {
+                m_core->recordExternalFrame(*commandBuffer, static_cast<uint32_t>(m_window->graphicsStateInfo().currentFrameSlot));
+            } catch (const std::exception& e) {
+                qWarning() << "Error during rendering:" << e.what();
+            }
+            m_window->endExternalCommands();
 
-            // Request another frame to keep the rendering loop going
-            if (window()) {
-                window()->update();
+            {
+                QMutexLocker lock(&m_stats->mutex);
+                m_stats->stats = m_core->getFrameStats();
+            }
+            // Keep going only while uploads or an animation still need frames, arrivals wake us through the callback
+            if (m_core->needsRedraw()) {
+                m_window->update();
             }
-        } catch (const std::exception& e) {
-            qWarning() << "Error during rendering:" << e.what();
         }
-    }
-}
 
-void VulkanRenderItem::cleanup() {
-    if (m_rendererInitialized) {
-        try {
-            core.destroy();
-        } catch (const std::exception& e) {
-            qWarning() << "Error during cleanup:" << e.what();
-        }
-    }
-    m_windowHandle = nullptr;
-    m_windowHandleReady = false;
-    m_rendererInitialized = false;
+        QQuickWindow *m_window;
+        std::shared_ptr<FrameStatsChannel> m_stats;
+        std::unique_ptr<RendererCore> m_core;
+        VkImage m_image = VK_NULL_HANDLE;
+        QSize m_pixelSize;
+    };
+
 }
 
-void VulkanRenderItem::releaseResources() {
-    // This is called when the item is about to be destroyed or its window is changing
-    cleanup();
+VulkanRenderItem::VulkanRenderItem(QQuickItem *parent) : QQuickItem(parent) {
+    // Set up necessary flags for rendering
+    setFlag(QQuickItem::ItemHasContents, true);
+
+    m_statsTimer.setInterval(250);
+    connect(&m_statsTimer, &QTimer::timeout, this, &VulkanRenderItem::publishFrameStats);
 }
 
-void* VulkanRenderItem::getNativeWindowHandle() {
-    if (!window()) {
-        return nullptr;
-    }
+VulkanRenderItem::~VulkanRenderItem() = default;
 
-#ifdef Q_OS_WIN
-    // Get the native Windows HWND
-    HWND hwnd = (HWND)window()->winId();
-    return hwnd;
-#elif defined(Q_OS_MACOS)
-    // For macOS, we need to get the NSView and set up a CAMetalLayer
-    NSView* nsView = (NSView*)window()->winId();
-    if (!nsView) {
-        return nullptr;
+QSGNode *VulkanRenderItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) {
+    auto *node = static_cast<VulkanRenderNode *>(oldNode);
+    QSize pixelSize = (size() * window()->effectiveDevicePixelRatio()).toSize();
+    if (pixelSize.isEmpty()) {
+        return node; // Keep the renderer, nothing to show until it has a size again
     }
 
-    // Make sure the view is layer-backed
-    [nsView setWantsLayer:YES];
-
-    // Create a CAMetalLayer if it doesn't exist
-    if (![nsView.layer isKindOfClass:[CAMetalLayer class]]) {
-        CAMetalLayer* metalLayer = [CAMetalLayer layer];
-        [nsView setLayer:metalLayer];
+    if (!node) {
+        if (m_initFailed) return nullptr;
+        node = new VulkanRenderNode(window(), m_stats);
+        if (!node->initialize(pixelSize)) {
+            delete node;
+            m_initFailed = true;
+            return nullptr;
+        }
+        m_ready = true;
+        QMetaObject::invokeMethod(this, [this]() {
+            emit readyChanged();
+            m_statsTimer.start();
+        }, Qt::QueuedConnection);
     }
+    node->sync(pixelSize, boundingRect());
+    return node;
+}
 
-    // Return the CAMetalLayer for Vulkan/MoltenVK
-    return (__bridge void*)nsView.layer;
-#else
-    // For other platforms
-    return nullptr;
-#endif
+void VulkanRenderItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) {
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size()) {
+        update(); // The next sync resizes the render target
+    }
 }
 
-void* VulkanRenderItem::getWindowHandle() {
-    return m_windowHandle;
+Veloxr::FrameStats VulkanRenderItem::frameStats() const {
+    QMutexLocker lock(&m_stats->mutex);
+    return m_stats->stats;
 }
 
-void VulkanRenderItem::initializeExternalRenderer() {
-    qDebug() << "Initializing external Vulkan renderer";
-    if (!m_windowHandleReady || !m_windowHandle) {
-        qWarning() << "Window handle not yet available";
+void VulkanRenderItem::publishFrameStats() {
+    quint64 frames = frameCount();
+    if (frames == m_publishedFrames) {
         return;
     }
+    m_publishedFrames = frames;
+    emit frameStatsChanged();
+}
 
-    try {
-        int width = window()->width() * window()->devicePixelRatio();
-        int height = window()->height() * window()->devicePixelRatio();
-        core.setWindowDimensions(width, height);
-
-        core.init(m_windowHandle);
-        m_rendererInitialized = true;
-
-        if (window()) {
-            window()->update();
-        }
-
-        qDebug() << "Vulkan renderer initialized successfully";
-    } catch (const std::exception& e) {
-        qWarning() << "Failed to initialize Vulkan renderer:" << e.what();
-    }
+void VulkanRenderItem::releaseResources() {
+    // The node, and the renderer with it, is deleted by the scene graph on the render thread
+    m_ready = false;
+    m_initFailed = false;
+    m_statsTimer.stop();
+    emit readyChanged();
 }
@@ -1,44 +1,81 @@
 #pragma once
 
+#include <QMutex>
 #include <QQuickItem>
 #include <QTimer>
+#include <memory>
 #include "renderer.h" // Include your RendererCore class
 
-// Platform-specific includes
-#ifdef Q_OS_WIN
-#include <windows.h>
-#elif defined(Q_OS_MACOS)
-#include <Cocoa/Cocoa.h>
-#include <QuartzCore/CAMetalLayer.h>
-#endif
+// Written by the render thread after each frame, read by the item's properties. Shared so either
+// side may go away first.
+struct FrameStatsChannel {
+    QMutex mutex;
+    Veloxr::FrameStats stats;
+};
 
+// Renders through the scene graph's own Vulkan device (QQuickWindow::setGraphicsApi(QSGRendererInterface::Vulkan)).
+// The renderer lives in the item's scene graph node on the render thread, records into Qt's frame
+// command buffer and its image is composited like any other texture, Qt presents and paces frames.
 class VulkanRenderItem : public QQuickItem {
     Q_OBJECT
     Q_PROPERTY(bool ready READ isReady NOTIFY readyChanged)
+    // Frame statistics for a HUD, milliseconds, refreshed a few times per second
+    Q_PROPERTY(double gpuUploadMs READ gpuUploadMs NOTIFY frameStatsChanged)
+    Q_PROPERTY(double gpuRenderMs READ gpuRenderMs NOTIFY frameStatsChanged)
+    Q_PROPERTY(double cpuAcquireMs READ cpuAcquireMs NOTIFY frameStatsChanged)
+    Q_PROPERTY(double cpuRecordMs READ cpuRecordMs NOTIFY frameStatsChanged)
+    Q_PROPERTY(double cpuSubmitMs READ cpuSubmitMs NOTIFY frameStatsChanged)
+    Q_PROPERTY(double cpuPresentMs READ cpuPresentMs NOTIFY frameStatsChanged)
+    Q_PROPERTY(double cpuFrameMs READ cpuFrameMs NOTIFY frameStatsChanged)
+    Q_PROPERTY(double cpuFrameP50Ms READ cpuFrameP50Ms NOTIFY frameStatsChanged)
+    Q_PROPERTY(double cpuFrameP95Ms READ cpuFrameP95Ms NOTIFY frameStatsChanged)
+    Q_PROPERTY(double cpuFrameP99Ms READ cpuFrameP99Ms NOTIFY frameStatsChanged)
+    Q_PROPERTY(double gpuFrameP50Ms READ gpuFrameP50Ms NOTIFY frameStatsChanged)
+    Q_PROPERTY(double gpuFrameP95Ms READ gpuFrameP95Ms NOTIFY frameStatsChanged)
+    Q_PROPERTY(double gpuFrameP99Ms READ gpuFrameP99Ms NOTIFY frameStatsChanged)
+    Q_PROPERTY(quint64 frameCount READ frameCount NOTIFY frameStatsChanged)
 
 public:
     VulkanRenderItem(QQuickItem *parent = nullptr);
     ~VulkanRenderItem();
 
-    bool isReady() const { return m_windowHandleReady; }
-    void* getWindowHandle();
+    bool isReady() const { return m_ready; }
+
+    // Safe from the GUI thread, the render thread publishes a copy after each frame
+    Veloxr::FrameStats frameStats() const;
+    double gpuUploadMs() const { return frameStats().gpuUploadMs; }
+    double gpuRenderMs() const { return frameStats().gpuRenderMs; }
+    double cpuAcquireMs() const { return frameStats().cpuAcquireMs; }
+    double cpuRecordMs() const { return frameStats().cpuRecordMs; }
+    double cpuSubmitMs() const { return frameStats().cpuSubmitMs; }
+    double cpuPresentMs() const { return frameStats().cpuPresentMs; }
+    double cpuFrameMs() const { return frameStats().cpuFrameMs; }
+    double cpuFrameP50Ms() const { return frameStats().cpuFrameP50Ms; }
+    double cpuFrameP95Ms() const { return frameStats().cpuFrameP95Ms; }
+    double cpuFrameP99Ms() const { return frameStats().cpuFrameP99Ms; }
+    double gpuFrameP50Ms() const { return frameStats().gpuFrameP50Ms; }
+    double gpuFrameP95Ms() const { return frameStats().gpuFrameP95Ms; }
+    double gpuFrameP99Ms() const { return frameStats().gpuFrameP99Ms; }
+    quint64 frameCount() const { return frameStats().frames; }
 
 signals:
     void readyChanged();
+    void frameStatsChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) override;
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
 
 private slots:
-    void handleWindowChanged(QQuickWindow *win);
-    void handleAfterRendering();
-    void render();
+    void publishFrameStats();
 
 private:
-    void cleanup();
     void releaseResources() override;
-    void* getNativeWindowHandle();
-    void initializeExternalRenderer();
 
-    void* m_windowHandle = nullptr;
-    bool m_windowHandleReady = false;
-    bool m_rendererInitialized = false;
-    RendererCore core;
+    bool m_ready = false;
+    bool m_initFailed = false; // Do not retry every sync
+    std::shared_ptr<FrameStatsChannel> m_stats = std::make_shared<FrameStatsChannel>();
+    quint64 m_publishedFrames = 0;
+    // Bindings re-evaluate on every notify, a HUD does not need more than a few updates per second
+    QTimer m_statsTimer;
 };